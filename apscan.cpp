@@ -0,0 +1,233 @@
+/*=============================================================================
+ * Copyright (c) 2021, Alejandro Rougier <alejandro.rougier@uner.edu.ar>
+ *
+ * All rights reserved.
+ * License: Free
+ * Date: 2021/11/12
+ * Version: v1.0
+ *===========================================================================*/
+
+/*==================[ Inclusions ]============================================*/
+
+#include "apscan.h"
+
+/*==================[ Local MAcros ]============================================*/
+#define CWLAPPREFIX         "+CWLAP:("
+#define CWLAPPREFIXLENGTH   8
+#define CWJAPPREFIX         "+CWJAP:"
+#define CWJAPPREFIXLENGTH   7
+
+/*==================[ Local Functions ]============================================*/
+
+/**
+ * @brief Convierte un dígito hexadecimal
+ *
+ * @param dato  Caracter
+ * @return int8_t Valor del dígito, -1 si no es hexadecimal
+ */
+static int8_t hexValue(uint8_t dato)
+{
+    if((dato>='0') && (dato<='9'))
+        return dato-'0';
+    if((dato>='a') && (dato<='f'))
+        return dato-'a'+10;
+    if((dato>='A') && (dato<='F'))
+        return dato-'A'+10;
+    return -1;
+}
+
+/**
+ * @brief Agrega un AP a la tabla o actualiza el que tiene la misma MAC
+ *
+ * @param scan  Puntero a la tabla
+ * @param ap    AP encontrado
+ */
+static void apScanAdd(_sApScan *scan, const _sApInfo *ap)
+{
+    uint8_t weakest=0;
+
+    for(uint8_t i=0; i<scan->count; i++){
+        if(!memcmp(scan->ap[i].bssid, ap->bssid, sizeof(ap->bssid))){
+            scan->ap[i]=*ap;
+            return;
+        }
+        if(scan->ap[i].rssi<scan->ap[weakest].rssi)
+            weakest=i;
+    }
+    if(scan->count<APTABLELENGTH){
+        scan->ap[scan->count++]=*ap;
+    }else if(ap->rssi>scan->ap[weakest].rssi){
+        scan->ap[weakest]=*ap;
+    }
+}
+
+/*==================[ Functions ]============================================*/
+
+void apScanInit(_sApScan *scan, const uint8_t *ssid, uint8_t ssidLength)
+{
+    memset(scan, 0, sizeof(_sApScan));
+    if(ssidLength>APSSIDLENGTH)
+        ssidLength=APSSIDLENGTH;
+    memcpy(scan->ssid, ssid, ssidLength);
+    scan->ssidLength=ssidLength;
+}
+
+void apScanByte(_sApScan *scan, uint8_t dato)
+{
+    int8_t nibble;
+
+    if(dato=='\n'){
+        if(((scan->lineLength>=2) && !memcmp(scan->line, "OK", 2)) || ((scan->lineLength>=5) && !memcmp(scan->line, "ERROR", 5)))
+            scan->done=true;
+        scan->lineLength=0;
+        scan->prefix=0;
+        return;
+    }
+    if(scan->lineLength<sizeof(scan->line))
+        scan->line[scan->lineLength++]=dato;
+
+    if(scan->prefix<CWLAPPREFIXLENGTH){
+        if(dato==CWLAPPREFIX[scan->prefix]){
+            scan->prefix++;
+            if(scan->prefix==CWLAPPREFIXLENGTH){
+                scan->field=scan->index=0;
+                scan->quoted=scan->negative=false;
+                scan->match=true;
+                scan->value=0;
+                memset(&scan->current, 0, sizeof(scan->current));
+            }
+        }else{
+            scan->prefix=(dato=='+') ? 1 : 0;
+        }
+        return;
+    }
+
+    if(dato=='"'){
+        scan->quoted=!scan->quoted;
+        return;
+    }
+    if(!scan->quoted && ((dato==',') || (dato==')'))){
+        switch(scan->field){
+            case 1:
+                scan->match=scan->match && (scan->index==scan->ssidLength);
+                break;
+            case 2:
+                scan->current.rssi=scan->negative ? -scan->value : scan->value;
+                break;
+            case 4:
+                scan->current.channel=scan->value;
+                break;
+            default:
+                break;
+        }
+        if(dato==')'){
+            if(scan->match && (scan->field>=4))
+                apScanAdd(scan, &scan->current);
+            scan->prefix=0;
+            return;
+        }
+        scan->field++;
+        scan->index=0;
+        scan->value=0;
+        scan->negative=false;
+        return;
+    }
+
+    switch(scan->field){
+        case 1:
+            if((scan->index>=scan->ssidLength) || (scan->ssid[scan->index]!=dato))
+                scan->match=false;
+            if(scan->index<0xFF)
+                scan->index++;
+            break;
+        case 2:
+        case 4:
+            if(dato=='-'){
+                scan->negative=true;
+            }else if((dato>='0') && (dato<='9') && (scan->value<1000)){
+                scan->value=scan->value*10+(dato-'0');
+            }
+            break;
+        case 3:
+            nibble=hexValue(dato);
+            if((nibble>=0) && (scan->index<12)){
+                scan->current.bssid[scan->index/2]=(scan->current.bssid[scan->index/2]<<4) | nibble;
+                scan->index++;
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+const _sApInfo *apScanBest(const _sApScan *scan)
+{
+    const _sApInfo *best=NULL;
+
+    for(uint8_t i=0; i<scan->count; i++){
+        if((best==NULL) || (scan->ap[i].rssi>best->rssi))
+            best=&scan->ap[i];
+    }
+    return best;
+}
+
+bool apParseJoined(const uint8_t *buff, uint8_t length, _sApInfo *ap)
+{
+    uint8_t prefix=0, field=0, index=0;
+    bool quoted=false, negative=false;
+    int16_t value=0;
+    int8_t nibble;
+
+    memset(ap, 0, sizeof(_sApInfo));
+    for(uint8_t i=0; i<length; i++){
+        if(prefix<CWJAPPREFIXLENGTH){
+            prefix=(buff[i]==CWJAPPREFIX[prefix]) ? prefix+1 : ((buff[i]=='+') ? 1 : 0);
+            continue;
+        }
+        if(buff[i]=='"'){
+            quoted=!quoted;
+            continue;
+        }
+        if(!quoted && ((buff[i]==',') || (buff[i]=='\r') || (buff[i]=='\n'))){
+            if(field==2)
+                ap->channel=value;
+            if(field==3){
+                ap->rssi=negative ? -value : value;
+                return index==12;
+            }
+            field++;
+            value=0;
+            negative=false;
+            continue;
+        }
+        if(field==1){
+            nibble=hexValue(buff[i]);
+            if((nibble>=0) && (index<12)){
+                ap->bssid[index/2]=(ap->bssid[index/2]<<4) | nibble;
+                index++;
+            }
+        }else if(field>=2){
+            if(buff[i]=='-'){
+                negative=true;
+            }else if((buff[i]>='0') && (buff[i]<='9') && (value<1000)){
+                value=value*10+(buff[i]-'0');
+            }
+        }
+    }
+    if(field==3){
+        ap->rssi=negative ? -value : value;
+        return index==12;
+    }
+    return false;
+}
+
+void apFormatBssid(const uint8_t *bssid, char *text)
+{
+    const char hex[]="0123456789abcdef";
+
+    for(uint8_t i=0; i<6; i++){
+        *text++=hex[bssid[i]>>4];
+        *text++=hex[bssid[i]&0x0F];
+        *text++=(i<5) ? ':' : '\0';
+    }
+}
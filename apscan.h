@@ -0,0 +1,105 @@
+/*=============================================================================
+ * Copyright (c) 2021, Alejandro Rougier <alejandro.rougier@uner.edu.ar>
+ *
+ * All rights reserved.
+ * License: Free
+ * Date: 2021/11/12
+ * Version: v1.0
+ *===========================================================================*/
+
+/*==================[ Inclusions ]============================================*/
+
+#ifndef APSCAN_H
+#define APSCAN_H
+
+#include "mbed.h"
+
+/*==================[ Macros ]============================================*/
+
+#define APTABLELENGTH   4       //!< Cantidad de APs del SSID configurado que se guardan
+#define APSSIDLENGTH    32      //!< Longitud máxima del SSID
+#define APBSSIDTEXT     18      //!< "aa:bb:cc:dd:ee:ff" más el '\0'
+
+/*==================[ Global Variables ]============================================*/
+
+/**
+ * @brief Datos de un AP encontrado
+ *
+ */
+typedef struct{
+    uint8_t bssid[6];       //!< MAC del AP
+    int8_t rssi;            //!< Intensidad de señal en dBm
+    uint8_t channel;        //!< Canal
+}_sApInfo;
+
+/**
+ * @brief Tabla de APs y estado del decodificador incremental de +CWLAP
+ *
+ */
+typedef struct{
+    _sApInfo ap[APTABLELENGTH];     //!< APs encontrados con el SSID buscado
+    uint8_t count;                  //!< Cantidad de APs en la tabla
+    uint8_t ssid[APSSIDLENGTH];     //!< SSID buscado
+    uint8_t ssidLength;             //!< Longitud del SSID buscado
+    bool done;                      //!< Se recibió la línea final (OK, ERROR)
+    uint8_t prefix;                 //!< Bytes de "+CWLAP:(" reconocidos
+    uint8_t field;                  //!< Campo en curso de la línea
+    uint8_t index;                  //!< Byte en curso dentro del campo
+    bool quoted;                    //!< Dentro de comillas
+    bool match;                     //!< El SSID de la línea coincide hasta ahora
+    bool negative;                  //!< El número en curso es negativo
+    int16_t value;                  //!< Número en curso
+    _sApInfo current;               //!< AP de la línea en curso
+    uint8_t line[6];                //!< Inicio de la línea para detectar OK/ERROR
+    uint8_t lineLength;
+}_sApScan;
+
+/*==================[ Functions ]============================================*/
+
+/**
+ * @brief Inicializa la tabla para buscar los APs de un SSID
+ *
+ * @param scan          Puntero a la tabla
+ * @param ssid          SSID buscado
+ * @param ssidLength    Longitud del SSID
+ */
+void apScanInit(_sApScan *scan, const uint8_t *ssid, uint8_t ssidLength);
+
+/**
+ * @brief Procesa un byte de la respuesta de AT+CWLAP
+ * Cada línea +CWLAP:(<ecn>,"<ssid>",<rssi>,"<mac>",<ch>,...) con el SSID buscado se guarda en la tabla,
+ * si la tabla está llena reemplaza al AP más débil.
+ *
+ * @param scan  Puntero a la tabla
+ * @param dato  Byte recibido
+ */
+void apScanByte(_sApScan *scan, uint8_t dato);
+
+/**
+ * @brief Devuelve el AP con mejor señal
+ *
+ * @param scan  Puntero a la tabla
+ * @return const _sApInfo* NULL si no se encontró ningún AP
+ */
+const _sApInfo *apScanBest(const _sApScan *scan);
+
+/**
+ * @brief Decodifica la respuesta de AT+CWJAP? (+CWJAP:"<ssid>","<bssid>",<ch>,<rssi>)
+ *
+ * @param buff      Respuesta del ESP
+ * @param length    Longitud de la respuesta
+ * @param ap        Datos del AP al que está conectado
+ * @return true     La respuesta tenía los datos
+ * @return false    No está conectado o la respuesta no es válida
+ */
+bool apParseJoined(const uint8_t *buff, uint8_t length, _sApInfo *ap);
+
+/**
+ * @brief Escribe la MAC como texto "aa:bb:cc:dd:ee:ff"
+ *
+ * @param bssid MAC del AP
+ * @param text  Buffer de al menos APBSSIDTEXT bytes
+ */
+void apFormatBssid(const uint8_t *bssid, char *text);
+
+#endif
@@ -0,0 +1,125 @@
+/*=============================================================================
+ * Copyright (c) 2021, Alejandro Rougier <alejandro.rougier@uner.edu.ar>
+ *
+ * All rights reserved.
+ * License: Free
+ * Date: 2021/11/12
+ * Version: v1.0
+ *===========================================================================*/
+
+/*==================[ Inclusions ]============================================*/
+
+#include "capture.h"
+
+/*==================[ Local MAcros ]============================================*/
+#define CAPTUREMASK         (CAPTURELENGTH-1)
+#define CAPTURETICKMASK     (0xFFFFFFFFUL>>CAPTURETICKSHIFT)    //!< Los ticks dan la vuelta con read_us()
+
+/*==================[ Local Functions ]============================================*/
+
+/**
+ * @brief Longitud del registro que empieza con el tag indicado
+ *
+ */
+static inline uint8_t captureRecordLength(uint8_t tag)
+{
+    return ((tag & CAPTUREDELTABITS)==CAPTUREDELTAEXT) ? CAPTURERECORDMAX : 2;
+}
+
+static inline uint16_t captureUsed(const _sCapture *capture)
+{
+    return (capture->indexWrite-capture->indexRead) & CAPTUREMASK;
+}
+
+/**
+ * @brief Escribe un registro descartando los más viejos si no hay lugar, con las interrupciones deshabilitadas
+ *
+ */
+static void capturePut(_sCapture *capture, uint8_t tag, uint16_t delta, uint8_t dato)
+{
+    uint8_t length=captureRecordLength(tag);
+
+    while((CAPTUREMASK-captureUsed(capture))<length){
+        capture->indexRead=(capture->indexRead+captureRecordLength(capture->buffer[capture->indexRead])) & CAPTUREMASK;
+        if(capture->lost<0xFFFF)
+            capture->lost++;
+    }
+    capture->buffer[capture->indexWrite]=tag;
+    capture->indexWrite=(capture->indexWrite+1) & CAPTUREMASK;
+    if(length==CAPTURERECORDMAX){
+        capture->buffer[capture->indexWrite]=delta & 0xFF;
+        capture->indexWrite=(capture->indexWrite+1) & CAPTUREMASK;
+        capture->buffer[capture->indexWrite]=delta>>8;
+        capture->indexWrite=(capture->indexWrite+1) & CAPTUREMASK;
+    }
+    capture->buffer[capture->indexWrite]=dato;
+    capture->indexWrite=(capture->indexWrite+1) & CAPTUREMASK;
+}
+
+/*==================[ Functions ]============================================*/
+
+void captureInit(_sCapture *capture, Timer *timer)
+{
+    memset(capture, 0, sizeof(_sCapture));
+    capture->timer=timer;
+}
+
+void captureStart(_sCapture *capture)
+{
+    core_util_critical_section_enter();
+    capture->indexWrite=capture->indexRead=0;
+    capture->lost=0;
+    capture->lastTick=(uint32_t)capture->timer->read_us()>>CAPTURETICKSHIFT;
+    capture->active=true;
+    core_util_critical_section_exit();
+}
+
+void captureStop(_sCapture *capture)
+{
+    capture->active=false;
+}
+
+void captureByte(_sCapture *capture, uint8_t port, bool tx, uint8_t dato)
+{
+    uint32_t tick, delta, gaps;
+    uint8_t tag;
+
+    if(!capture->active)
+        return;
+
+    // Se llama desde las IRQ de recepción y desde el lazo principal, el registro se escribe completo sin interrupciones
+    core_util_critical_section_enter();
+    tick=(uint32_t)capture->timer->read_us()>>CAPTURETICKSHIFT;
+    delta=(tick-capture->lastTick) & CAPTURETICKMASK;
+    capture->lastTick=tick;
+    tag=(port<<CAPTUREPORTSHIFT) | (tx ? CAPTURETX : 0);
+
+    // Lo que no entra en el delta extendido va en registros de pausa, como mucho 5 por la vuelta de los ticks
+    while(delta>=CAPTUREGAP){
+        gaps=delta/CAPTUREGAP;
+        if(gaps>0xFF)
+            gaps=0xFF;
+        capturePut(capture, tag | CAPTUREDELTAEXT, CAPTUREGAP, gaps);
+        delta-=gaps*CAPTUREGAP;
+    }
+    capturePut(capture, tag | ((delta<CAPTUREDELTAEXT) ? delta : CAPTUREDELTAEXT), delta, dato);
+    core_util_critical_section_exit();
+}
+
+uint8_t captureRead(_sCapture *capture, uint8_t *buff, uint8_t maxLength)
+{
+    uint8_t count=0, length;
+
+    core_util_critical_section_enter();
+    while(captureUsed(capture)){
+        length=captureRecordLength(capture->buffer[capture->indexRead]);
+        if((count+length)>maxLength)
+            break;
+        for(uint8_t i=0; i<length; i++){
+            buff[count++]=capture->buffer[capture->indexRead];
+            capture->indexRead=(capture->indexRead+1) & CAPTUREMASK;
+        }
+    }
+    core_util_critical_section_exit();
+    return count;
+}
@@ -0,0 +1,104 @@
+/*=============================================================================
+ * Copyright (c) 2021, Alejandro Rougier <alejandro.rougier@uner.edu.ar>
+ *
+ * All rights reserved.
+ * License: Free
+ * Date: 2021/11/12
+ * Version: v1.0
+ *===========================================================================*/
+
+/*==================[ Inclusions ]============================================*/
+
+#ifndef CAPTURE_H
+#define CAPTURE_H
+
+#include "mbed.h"
+
+/*==================[ Macros ]============================================*/
+
+#define CAPTURELENGTH       4096    //!< Tamaño del buffer circular de la captura (potencia de 2), más de 1000 bytes
+#define CAPTURETICKSHIFT    6       //!< Resolución de las marcas de tiempo: 1<<CAPTURETICKSHIFT us
+#define CAPTUREDELTABITS    0x1F    //!< Bits del tag con el delta de tiempo
+#define CAPTUREDELTAEXT     0x1F    //!< Delta que indica que siguen 2 bytes con el delta (u16 little-endian)
+#define CAPTUREGAP          0xFFFF  //!< Delta extendido de un registro de pausa, sin byte capturado
+#define CAPTURETX           0x20    //!< Bit del tag que indica byte transmitido
+#define CAPTUREPORTSHIFT    6       //!< Los 2 bits altos del tag son el puerto
+#define CAPTURERECORDMAX    4       //!< Longitud del registro más largo
+
+/*==================[ Global Variables ]============================================*/
+
+/**
+ * @brief Puertos que se pueden capturar
+ *
+ */
+typedef enum{
+    CAPTUREPC,          //!< pcCom
+    CAPTUREWIFI0,       //!< Puerto del primer ESP
+    CAPTUREWIFI1        //!< Puerto del segundo ESP
+}_eCapturePort;
+
+/**
+ * @brief Captura de los bytes de los puertos serie
+ * Cada byte se guarda como un registro [tag][delta u16 opcional][dato]. El tag lleva el puerto, si es TX y el
+ * tiempo desde el registro anterior en ticks de 1<<CAPTURETICKSHIFT us; si no entra en 5 bits vale
+ * CAPTUREDELTAEXT y el delta va en los 2 bytes siguientes. Si tampoco entra en 16 bits antes del registro van
+ * registros de pausa con el delta extendido en CAPTUREGAP: en lugar del dato llevan cuántas veces CAPTUREGAP ticks
+ * pasaron (unos 4 s cada vez, hasta 17 minutos por registro), así las pausas largas no se pierden ni llenan el buffer.
+ * Con el buffer lleno se descartan los registros más viejos, así siempre queda lo último que pasó.
+ */
+typedef struct{
+    uint8_t buffer[CAPTURELENGTH];
+    uint16_t indexWrite;            //!< Indice de escritura
+    uint16_t indexRead;             //!< Primer registro sin leer
+    uint32_t lastTick;              //!< Momento del último registro en ticks
+    uint16_t lost;                  //!< Registros descartados por buffer lleno
+    bool active;                    //!< La captura está en marcha
+    Timer *timer;                   //!< Timer de donde salen las marcas de tiempo
+}_sCapture;
+
+/*==================[ Functions ]============================================*/
+
+/**
+ * @brief Inicializa la captura detenida
+ *
+ * @param capture   Captura
+ * @param timer     Timer en marcha del que se leen las marcas de tiempo
+ */
+void captureInit(_sCapture *capture, Timer *timer);
+
+/**
+ * @brief Vacía el buffer y arranca la captura, el primer registro lleva el tiempo desde este momento
+ *
+ * @param capture   Captura
+ */
+void captureStart(_sCapture *capture);
+
+/**
+ * @brief Detiene la captura, lo capturado se puede seguir leyendo
+ *
+ * @param capture   Captura
+ */
+void captureStop(_sCapture *capture);
+
+/**
+ * @brief Registra un byte, se puede llamar desde las interrupciones de recepción
+ *
+ * @param capture   Captura
+ * @param port      Puerto (_eCapturePort)
+ * @param tx        true si el byte se transmitió, false si se recibió
+ * @param dato      Byte
+ */
+void captureByte(_sCapture *capture, uint8_t port, bool tx, uint8_t dato);
+
+/**
+ * @brief Saca registros completos del buffer. La captura tiene que estar detenida, si no lo que se transmite con
+ * lo leído se vuelve a capturar
+ *
+ * @param capture   Captura
+ * @param buff      Destino
+ * @param maxLength Tamaño del destino
+ * @return uint8_t  Bytes copiados, 0 si no hay más registros
+ */
+uint8_t captureRead(_sCapture *capture, uint8_t *buff, uint8_t maxLength);
+
+#endif
@@ -0,0 +1,79 @@
+/*=============================================================================
+ * Copyright (c) 2021, Alejandro Rougier <alejandro.rougier@uner.edu.ar>
+ *
+ * All rights reserved.
+ * License: Free
+ * Date: 2021/11/12
+ * Version: v1.0
+ *===========================================================================*/
+
+/*==================[ Inclusions ]============================================*/
+
+#include "cobs.h"
+
+/*==================[ Functions ]============================================*/
+
+uint8_t cobsEncodeRing(uint8_t *ring, uint8_t mask, uint8_t start, uint8_t length)
+{
+    uint8_t indexCode=start, distance=1, index;
+
+    if(length>COBSMAXFRAME)
+        return 0;
+
+    for(uint8_t i=0; i<length; i++){
+        index=(start+1+i) & mask;
+        if(ring[index]==COBSDELIMITER){
+            ring[indexCode]=distance;
+            indexCode=index;
+            distance=1;
+        }else{
+            distance++;
+        }
+    }
+    ring[indexCode]=distance;
+    ring[(start+1+length) & mask]=COBSDELIMITER;
+    return length+2;
+}
+
+uint8_t cobsDecodeRing(uint8_t *ring, uint8_t mask, uint8_t start, uint8_t length)
+{
+    uint8_t indexIn=start, indexOut=start, code, decoded=0;
+
+    while(length){
+        code=ring[indexIn];
+        if((code==COBSDELIMITER) || (code>length))
+            return 0;
+        indexIn=(indexIn+1) & mask;
+        length--;
+        for(uint8_t i=1; i<code; i++){
+            ring[indexOut]=ring[indexIn];
+            indexOut=(indexOut+1) & mask;
+            indexIn=(indexIn+1) & mask;
+            decoded++;
+        }
+        length-=code-1;
+        if(length && (code<0xFF)){
+            ring[indexOut]=COBSDELIMITER;
+            indexOut=(indexOut+1) & mask;
+            decoded++;
+        }
+    }
+    return decoded;
+}
+
+bool cobsFindDelimiter(const uint8_t *ring, uint16_t size, uint16_t from, uint16_t to, uint16_t *position)
+{
+    const uint8_t *found;
+    uint16_t end;
+
+    while(from!=to){
+        end=(to>from) ? to : size;
+        found=(const uint8_t *)memchr(&ring[from], COBSDELIMITER, end-from);
+        if(found!=NULL){
+            *position=found-ring;
+            return true;
+        }
+        from=(end==size) ? 0 : end;
+    }
+    return false;
+}
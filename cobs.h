@@ -0,0 +1,66 @@
+/*=============================================================================
+ * Copyright (c) 2021, Alejandro Rougier <alejandro.rougier@uner.edu.ar>
+ *
+ * All rights reserved.
+ * License: Free
+ * Date: 2021/11/12
+ * Version: v1.0
+ *===========================================================================*/
+
+/*==================[ Inclusions ]============================================*/
+
+#ifndef COBS_H
+#define COBS_H
+
+#include "mbed.h"
+
+/*==================[ Macros ]============================================*/
+
+#define COBSDELIMITER   0x00    //!< Byte que delimita las tramas COBS
+
+/**
+ * @brief Máxima cantidad de bytes de datos de una trama COBS.
+ * Con este límite nunca aparece un bloque de 254 bytes sin ceros, por lo que la codificación
+ * puede hacerse sobre el mismo buffer y el overhead queda fijo en 2 bytes (código inicial + delimitador)
+ */
+#define COBSMAXFRAME    253
+
+/*==================[ Functions ]============================================*/
+
+/**
+ * @brief Codifica una trama COBS sobre el mismo buffer circular
+ *
+ * @param ring      Puntero al buffer circular
+ * @param mask      Máscara del buffer circular (tamaño - 1, el tamaño debe ser potencia de 2 y <= 256)
+ * @param start     Posición reservada para el primer código, los datos arrancan en start+1
+ * @param length    Cantidad de bytes de datos (como máximo COBSMAXFRAME)
+ * @return uint8_t  Cantidad de bytes ocupados por la trama codificada incluyendo el delimitador, 0 si no entra
+ */
+uint8_t cobsEncodeRing(uint8_t *ring, uint8_t mask, uint8_t start, uint8_t length);
+
+/**
+ * @brief Decodifica una trama COBS sobre el mismo buffer circular
+ * Los datos decodificados quedan a partir de start.
+ *
+ * @param ring      Puntero al buffer circular
+ * @param mask      Máscara del buffer circular
+ * @param start     Posición del primer código de la trama
+ * @param length    Cantidad de bytes codificados sin contar el delimitador
+ * @return uint8_t  Cantidad de bytes decodificados, 0 si la trama es inválida
+ */
+uint8_t cobsDecodeRing(uint8_t *ring, uint8_t mask, uint8_t start, uint8_t length);
+
+/**
+ * @brief Busca el delimitador entre from y to recorriendo los tramos contiguos del buffer circular
+ *
+ * @param ring      Puntero al buffer circular
+ * @param size      Tamaño del buffer circular
+ * @param from      Posición desde donde se busca
+ * @param to        Posición hasta donde se busca (sin incluirla)
+ * @param position  Posición del delimitador si se encontró
+ * @return true     Se encontró el delimitador
+ * @return false    No hay delimitador entre from y to
+ */
+bool cobsFindDelimiter(const uint8_t *ring, uint16_t size, uint16_t from, uint16_t to, uint16_t *position);
+
+#endif
@@ -0,0 +1,135 @@
+/*=============================================================================
+ * Copyright (c) 2021, Alejandro Rougier <alejandro.rougier@uner.edu.ar>
+ *
+ * All rights reserved.
+ * License: Free
+ * Date: 2021/11/12
+ * Version: v1.0
+ *===========================================================================*/
+
+/*==================[ Inclusions ]============================================*/
+
+#include "compress.h"
+#include <string.h>
+
+/*==================[ Local MAcros ]============================================*/
+#define LZHASHSIZE      (1<<LZHASHBITS)
+#define LZMAXDISTANCE   255
+
+/*==================[ Local Functions ]============================================*/
+
+/**
+ * @brief Byte i del bloque luego de la codificación delta
+ *
+ */
+static inline uint8_t deltaAt(const uint8_t *src, uint8_t index, uint8_t stride)
+{
+    return (stride && (index>=stride)) ? (uint8_t)(src[index]-src[index-stride]) : src[index];
+}
+
+static inline uint8_t lzHash(const uint8_t *src, uint8_t index, uint8_t stride)
+{
+    uint16_t value=(deltaAt(src, index, stride)<<8) ^ (deltaAt(src, index+1, stride)<<4) ^ deltaAt(src, index+2, stride);
+    return (value ^ (value>>LZHASHBITS)) & (LZHASHSIZE-1);
+}
+
+/**
+ * @brief Emite los literales pendientes en tokens de hasta LZMAXLITERALS
+ *
+ */
+static uint16_t lzFlushLiterals(const uint8_t *src, uint8_t from, uint8_t to, uint8_t stride, lzSink sink, void *context)
+{
+    uint16_t count=0;
+    uint8_t run;
+
+    while(from<to){
+        run=((to-from)>LZMAXLITERALS) ? LZMAXLITERALS : to-from;
+        if(sink!=NULL){
+            sink(context, run-1);
+            for(uint8_t i=0; i<run; i++)
+                sink(context, deltaAt(src, from+i, stride));
+        }
+        count+=run+1;
+        from+=run;
+    }
+    return count;
+}
+
+/*==================[ Functions ]============================================*/
+
+uint16_t lzCompress(const uint8_t *src, uint8_t length, uint8_t stride, lzSink sink, void *context)
+{
+    uint8_t hashTable[LZHASHSIZE];
+    uint16_t count=0, index=0, literalStart=0, candidate, matchLength, maxLength;
+    uint8_t hash;
+
+    memset(hashTable, 0, sizeof(hashTable));
+    while((index+LZMINMATCH)<=length){
+        hash=lzHash(src, index, stride);
+        candidate=hashTable[hash];
+        hashTable[hash]=index;
+        matchLength=0;
+        // La tabla solo guarda posiciones anteriores, se verifica igual porque distintos prefijos comparten hash
+        if((candidate<index) && ((index-candidate)<=LZMAXDISTANCE)){
+            maxLength=length-index;
+            if(maxLength>LZMAXMATCH)
+                maxLength=LZMAXMATCH;
+            while((matchLength<maxLength) && (deltaAt(src, candidate+matchLength, stride)==deltaAt(src, index+matchLength, stride)))
+                matchLength++;
+        }
+        if(matchLength<LZMINMATCH){
+            index++;
+            continue;
+        }
+        count+=lzFlushLiterals(src, literalStart, index, stride, sink, context);
+        if(sink!=NULL){
+            sink(context, 0x80 | (matchLength-LZMINMATCH));
+            sink(context, index-candidate);
+        }
+        count+=2;
+        for(uint16_t i=index+1; ((i+LZMINMATCH)<=length) && (i<(index+matchLength)); i++)
+            hashTable[lzHash(src, i, stride)]=i;
+        index+=matchLength;
+        literalStart=index;
+    }
+    count+=lzFlushLiterals(src, literalStart, length, stride, sink, context);
+    return count;
+}
+
+uint16_t lzDecompress(const uint8_t *ring, uint8_t mask, uint8_t indexIn, uint8_t length, uint8_t stride, uint8_t *out, uint16_t outSize)
+{
+    uint16_t indexOut=0, run;
+    uint8_t token, distance;
+
+    while(length){
+        token=ring[indexIn];
+        indexIn=(indexIn+1) & mask;
+        length--;
+        if(token<0x80){
+            run=token+1;
+            if((run>length) || ((indexOut+run)>outSize))
+                return 0;
+            for(uint16_t i=0; i<run; i++){
+                out[indexOut++]=ring[indexIn];
+                indexIn=(indexIn+1) & mask;
+            }
+            length-=run;
+        }else{
+            if(length==0)
+                return 0;
+            run=(token & 0x7F)+LZMINMATCH;
+            distance=ring[indexIn];
+            indexIn=(indexIn+1) & mask;
+            length--;
+            if((distance==0) || (distance>indexOut) || ((indexOut+run)>outSize))
+                return 0;
+            for(uint16_t i=0; i<run; i++, indexOut++)
+                out[indexOut]=out[indexOut-distance];
+        }
+    }
+    if(stride){
+        for(uint16_t i=stride; i<indexOut; i++)
+            out[i]+=out[i-stride];
+    }
+    return indexOut;
+}
@@ -0,0 +1,68 @@
+/*=============================================================================
+ * Copyright (c) 2021, Alejandro Rougier <alejandro.rougier@uner.edu.ar>
+ *
+ * All rights reserved.
+ * License: Free
+ * Date: 2021/11/12
+ * Version: v1.0
+ *===========================================================================*/
+
+/*==================[ Inclusions ]============================================*/
+
+#ifndef COMPRESS_H
+#define COMPRESS_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/*==================[ Macros ]============================================*/
+
+#define LZMINMATCH      3       //!< Longitud mínima de una referencia
+#define LZMAXMATCH      130     //!< Longitud máxima de una referencia (0x7F + LZMINMATCH)
+#define LZMAXLITERALS   128     //!< Literales máximos por token
+#define LZHASHBITS      6       //!< Tabla de hash de 64 bytes en la pila del compresor
+
+/*==================[ Global Variables ]============================================*/
+
+/**
+ * @brief Función que recibe cada byte comprimido
+ *
+ * @param context   Puntero que se le pasó al compresor
+ * @param dato      Byte comprimido
+ */
+typedef void (*lzSink)(void *context, uint8_t dato);
+
+/*==================[ Functions ]============================================*/
+
+/**
+ * @brief Comprime un bloque con codificación delta y LZ sobre el mismo bloque
+ * La ventana es el propio bloque, por lo que no guarda estado entre tramas y el tiempo es lineal en
+ * la longitud. Formato de salida, una secuencia de tokens:
+ *  - token < 0x80: siguen token+1 literales
+ *  - token >= 0x80: referencia de (token & 0x7F)+LZMINMATCH bytes, sigue un byte con la distancia (1..255)
+ * Con stride distinto de 0 se comprime x[i]-x[i-stride], útil para muestras que varían poco.
+ *
+ * @param src       Datos a comprimir
+ * @param length    Cantidad de datos
+ * @param stride    Paso de la codificación delta en bytes (0 sin delta, 2 para muestras de 16 bits)
+ * @param sink      Función que recibe los bytes comprimidos, NULL para solo calcular el tamaño
+ * @param context   Puntero que se le pasa a sink
+ * @return uint16_t Cantidad de bytes comprimidos
+ */
+uint16_t lzCompress(const uint8_t *src, uint8_t length, uint8_t stride, lzSink sink, void *context);
+
+/**
+ * @brief Descomprime un bloque generado por lzCompress
+ *
+ * @param ring      Buffer circular con los datos comprimidos
+ * @param mask      Máscara del buffer circular (tamaño - 1, 0xFF para un buffer lineal de 256)
+ * @param indexIn   Posición del primer byte comprimido
+ * @param length    Cantidad de bytes comprimidos
+ * @param stride    Paso de la codificación delta que se usó al comprimir
+ * @param out       Buffer de salida
+ * @param outSize   Tamaño del buffer de salida
+ * @return uint16_t Cantidad de bytes descomprimidos, 0 si los datos son inválidos
+ */
+uint16_t lzDecompress(const uint8_t *ring, uint8_t mask, uint8_t indexIn, uint8_t length, uint8_t stride, uint8_t *out, uint16_t outSize);
+
+#endif
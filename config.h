@@ -4,6 +4,76 @@
 
 #define AUTOCONNECTWIFI 1
 
+/**
+ * @brief Cantidad de módulos ESP8266 conectados. Con más de uno el tráfico que genera el equipo
+ * se reparte entre los módulos listos y si uno se cae los demás siguen transmitiendo
+ * 
+ */
+#define WIFIMODULES     1
+
+#define WIFITX0         PB_10   //!< TX del puerto serie del primer ESP
+#define WIFIRX0         PB_11   //!< RX del puerto serie del primer ESP
+#define WIFICHPD0       PA_3    //!< CH_PD del primer ESP
+
+//<! El segundo ESP necesita su propio puerto serie y CH_PD. La única USART libre es USART2 (PA_2/PA_3), que usa
+//<! el pin del CH_PD del primero: para WIFIMODULES 2 hay que pasar WIFICHPD0 a otro pin (por ejemplo PA_4) o no compila
+#define WIFITX1         PA_2
+#define WIFIRX1         PA_3
+#define WIFICHPD1       PB_1
+
+/**
+ * @brief Control de flujo RTS/CTS con el primer ESP, 0 deshabilitado
+ * RTS puede ser cualquier salida porque se maneja por software, CTS tiene que ser el CTS de la USART (PB_13 en USART3).
+ * Hay que habilitarlo también en el ESP, por ejemplo con AT+UART_DEF=115200,8,1,0,3
+ * 
+ */
+#define WIFIFLOWCONTROL 0
+#define WIFIRTS0        PB_14   //!< Va al CTS (GPIO13) del ESP
+#define WIFICTS0        PB_13   //!< Va al RTS (GPIO15) del ESP
+
+/**
+ * @brief Con 1 se compila la captura de los puertos serie y el comando CAPTURE. El buffer ocupa CAPTURELENGTH bytes
+ * de RAM (4 KB de los 20 KB del F103) aunque no se use, por eso solo se habilita para depurar. Con 0 el comando
+ * CAPTURE responde como desconocido
+ * 
+ */
+#ifndef CAPTUREENABLE
+#define CAPTUREENABLE   0
+#endif
+
+/**
+ * @brief Con 1 la captura de los puertos serie arranca al encender, antes de configurar el ESP,
+ * para poder reproducir el arranque con tools/replay. Con 0 se arranca con el comando CAPTURE.
+ * Necesita CAPTUREENABLE
+ * 
+ */
+#ifndef CAPTUREATBOOT
+#define CAPTUREATBOOT   0
+#endif
+#if CAPTUREATBOOT && !CAPTUREENABLE
+#error "CAPTUREATBOOT necesita CAPTUREENABLE"
+#endif
+
+/**
+ * @brief Roaming con la conexión activa, 0 deshabilitado
+ * Cada ROAMINTERVAL ms se sale del modo transparente para consultar la señal con AT+CWJAP? (más de 1 s sin recibir
+ * UDP). Si está por debajo de ROAMTHRESHOLD dBm se buscan los APs del SSID y se cambia al que supere al actual
+ * en ROAMHYSTERESIS dB. La elección del AP al configurar se hace siempre.
+ * 
+ */
+#ifndef WIFIROAMING
+#define WIFIROAMING     0
+#endif
+#ifndef ROAMINTERVAL
+#define ROAMINTERVAL    300000
+#endif
+#ifndef ROAMTHRESHOLD
+#define ROAMTHRESHOLD   -75
+#endif
+#ifndef ROAMHYSTERESIS
+#define ROAMHYSTERESIS  8
+#endif
+
 /**
  * @brief Cadena constante para configurar el Wifi Automaticamente sin enviar datos 
  * desde la PC
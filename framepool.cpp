@@ -0,0 +1,70 @@
+/*=============================================================================
+ * Copyright (c) 2021, Alejandro Rougier <alejandro.rougier@uner.edu.ar>
+ *
+ * All rights reserved.
+ * License: Free
+ * Date: 2021/11/12
+ * Version: v1.0
+ *===========================================================================*/
+
+/*==================[ Inclusions ]============================================*/
+
+#include "framepool.h"
+
+/*==================[ Local MAcros ]============================================*/
+#define FRAMEINDEXMASK      0x000000FF
+#define FRAMETAGINCREMENT   0x00000100
+
+/*==================[ Functions ]============================================*/
+
+void framePoolInit(_sFramePool *pool)
+{
+    memset(pool, 0, sizeof(_sFramePool));
+    for(uint8_t i=0; i<FRAMEPOOLBLOCKS; i++)
+        pool->next[i]=(i<(FRAMEPOOLBLOCKS-1)) ? i+1 : FRAMENONE;
+    pool->head=0;
+}
+
+frameHandle frameAlloc(_sFramePool *pool)
+{
+    uint32_t head=pool->head, newHead, used, highWater;
+    uint8_t index;
+
+    do{
+        index=head & FRAMEINDEXMASK;
+        if(index==FRAMENONE){
+            core_util_atomic_incr_u32(&pool->fails, 1);
+            return FRAMENONE;
+        }
+        newHead=((head+FRAMETAGINCREMENT) & ~FRAMEINDEXMASK) | pool->next[index];
+    }while(!core_util_atomic_cas_u32(&pool->head, &head, newHead));
+
+    used=core_util_atomic_incr_u32(&pool->used, 1);
+    highWater=pool->highWater;
+    while((used>highWater) && !core_util_atomic_cas_u32(&pool->highWater, &highWater, used));
+    return index;
+}
+
+void frameFree(_sFramePool *pool, frameHandle handle)
+{
+    uint32_t head=pool->head, newHead;
+
+    if(handle>=FRAMEPOOLBLOCKS)
+        return;
+    // Se descuenta antes de publicarlo para que used nunca supere la cantidad de bloques
+    core_util_atomic_decr_u32(&pool->used, 1);
+    do{
+        pool->next[handle]=head & FRAMEINDEXMASK;
+        newHead=((head+FRAMETAGINCREMENT) & ~FRAMEINDEXMASK) | handle;
+    }while(!core_util_atomic_cas_u32(&pool->head, &head, newHead));
+}
+
+uint8_t *frameData(_sFramePool *pool, frameHandle handle)
+{
+    return pool->memory[handle];
+}
+
+uint8_t framePoolFree(const _sFramePool *pool)
+{
+    return FRAMEPOOLBLOCKS-pool->used;
+}
@@ -0,0 +1,88 @@
+/*=============================================================================
+ * Copyright (c) 2021, Alejandro Rougier <alejandro.rougier@uner.edu.ar>
+ *
+ * All rights reserved.
+ * License: Free
+ * Date: 2021/11/12
+ * Version: v1.0
+ *===========================================================================*/
+
+/*==================[ Inclusions ]============================================*/
+
+#ifndef FRAMEPOOL_H
+#define FRAMEPOOL_H
+
+#include "mbed.h"
+
+/*==================[ Macros ]============================================*/
+
+#define FRAMEPOOLBLOCKS     8       //!< Bloques compartidos por todos los canales (máximo 255)
+#define FRAMEBLOCKSIZE      80      //!< Bytes por bloque, una trama entera (máximo 256)
+#define FRAMENONE           0xFF    //!< Handle inválido
+
+/*==================[ Global Variables ]============================================*/
+
+/**
+ * @brief Handle de un bloque del pool
+ *
+ */
+typedef uint8_t frameHandle;
+
+/**
+ * @brief Pool de bloques de tamaño fijo
+ * Los bloques libres forman una pila enlazada por next[]. head lleva el índice del primero en el byte bajo
+ * y un contador en el resto que cambia en cada operación, así un compare-and-swap con un head viejo falla
+ * aunque el mismo bloque haya vuelto a quedar primero (problema ABA).
+ */
+typedef struct{
+    volatile uint32_t head;                     //!< Contador y primer bloque libre
+    volatile uint8_t next[FRAMEPOOLBLOCKS];     //!< Siguiente bloque libre de cada bloque
+    volatile uint32_t used;                     //!< Bloques en uso
+    volatile uint32_t highWater;                //!< Máximo de bloques en uso desde el inicio
+    volatile uint32_t fails;                    //!< Pedidos que no se pudieron atender
+    uint8_t memory[FRAMEPOOLBLOCKS][FRAMEBLOCKSIZE];
+}_sFramePool;
+
+/*==================[ Functions ]============================================*/
+
+/**
+ * @brief Inicializa el pool con todos los bloques libres
+ *
+ * @param pool  Pool a inicializar
+ */
+void framePoolInit(_sFramePool *pool);
+
+/**
+ * @brief Pide un bloque, O(1) y sin bloquear, se puede llamar desde una interrupción
+ *
+ * @param pool          Pool
+ * @return frameHandle  Bloque asignado, FRAMENONE si no hay libres
+ */
+frameHandle frameAlloc(_sFramePool *pool);
+
+/**
+ * @brief Devuelve un bloque al pool, O(1) y sin bloquear, se puede llamar desde una interrupción
+ *
+ * @param pool      Pool
+ * @param handle    Bloque a liberar, FRAMENONE se ignora
+ */
+void frameFree(_sFramePool *pool, frameHandle handle);
+
+/**
+ * @brief Datos de un bloque
+ *
+ * @param pool      Pool
+ * @param handle    Bloque
+ * @return uint8_t* Puntero a los FRAMEBLOCKSIZE bytes del bloque
+ */
+uint8_t *frameData(_sFramePool *pool, frameHandle handle);
+
+/**
+ * @brief Cantidad de bloques libres
+ *
+ * @param pool      Pool
+ * @return uint8_t  Bloques libres en este momento
+ */
+uint8_t framePoolFree(const _sFramePool *pool);
+
+#endif
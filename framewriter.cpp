@@ -0,0 +1,125 @@
+/*=============================================================================
+ * Copyright (c) 2021, Alejandro Rougier <alejandro.rougier@uner.edu.ar>
+ *
+ * All rights reserved.
+ * License: Free
+ * Date: 2021/11/12
+ * Version: v1.0
+ *===========================================================================*/
+
+/*==================[ Inclusions ]============================================*/
+
+#include "framewriter.h"
+
+/*==================[ Local MAcros ]============================================*/
+#define UNERHEADERLENGTH    6       //!< 'U','N','E','R',NBYTES,':'
+#define UNERMAXBYTES        254     //!< NBYTES incluye el cheksum y es de un byte
+#define COBSMAXBYTES        (COBSMAXFRAME-3)    //!< NBYTES, ':' y cheksum también van codificados
+#define UNEROVERHEAD        (UNERHEADERLENGTH+1)        //!< Cabecera y cheksum
+#define COBSOVERHEAD        5                           //!< Código, NBYTES, ':', cheksum y delimitador
+
+/*==================[ Public Methods ]============================================*/
+
+FrameWriter::FrameWriter(uint8_t *ring, uint8_t mask, uint8_t *indexWrite, const uint8_t *indexRead, uint8_t framing)
+{
+    uint8_t freeBytes=(*indexRead-*indexWrite-1) & mask;
+    uint8_t overhead=(framing==FRAMINGCOBS) ? COBSOVERHEAD : UNEROVERHEAD;
+
+    ringTx=ring;
+    maskTx=mask;
+    indexWriteTx=indexWrite;
+    framingTx=framing;
+    indexFrame=*indexWrite;
+    nBytes=0;
+    overflow=false;
+    cheksum='U'^'N'^'E'^'R'^':';
+    // La trama completa tiene que entrar en el espacio libre del buffer
+    maxBytes=(freeBytes>overhead) ? freeBytes-overhead : 0;
+    if(freeBytes<overhead){
+        overflow=true;
+        indexNBytes=indexData=indexFrame;
+        return;
+    }
+
+    if(framingTx==FRAMINGCOBS){
+        indexNBytes=(indexFrame+1) & maskTx;        // indexFrame queda reservado para el primer código COBS
+        if(maxBytes>COBSMAXBYTES)
+            maxBytes=COBSMAXBYTES;
+    }else{
+        ringTx[indexFrame]='U';
+        ringTx[(indexFrame+1) & maskTx]='N';
+        ringTx[(indexFrame+2) & maskTx]='E';
+        ringTx[(indexFrame+3) & maskTx]='R';
+        indexNBytes=(indexFrame+4) & maskTx;
+        if(maxBytes>UNERMAXBYTES)
+            maxBytes=UNERMAXBYTES;
+    }
+    ringTx[(indexNBytes+1) & maskTx]=':';
+    indexData=(indexNBytes+2) & maskTx;
+}
+
+FrameWriter &FrameWriter::u8(uint8_t value){
+    if(nBytes>=maxBytes){
+        overflow=true;
+        return *this;
+    }
+    ringTx[indexData]=value;
+    indexData=(indexData+1) & maskTx;
+    cheksum^=value;
+    nBytes++;
+    return *this;
+}
+
+FrameWriter &FrameWriter::f32(float value){
+    uint32_t raw;
+    memcpy(&raw, &value, sizeof(raw));
+    return put<uint32_t>(raw);
+}
+
+FrameWriter &FrameWriter::array(const uint8_t *buff, uint8_t length){
+    for(uint8_t i=0; i<length; i++)
+        u8(buff[i]);
+    return *this;
+}
+
+void FrameWriter::patch(uint8_t position, uint8_t value){
+    uint8_t index=(indexNBytes+2+position) & maskTx;
+
+    if(position>=nBytes)
+        return;
+    cheksum^=ringTx[index]^value;
+    ringTx[index]=value;
+}
+
+void FrameWriter::truncate(uint8_t position){
+    if(position>nBytes)
+        return;
+    while(nBytes>position){
+        indexData=(indexData-1) & maskTx;
+        cheksum^=ringTx[indexData];
+        nBytes--;
+    }
+    // Con maxBytes en 0 no había lugar ni para la cabecera, la trama sigue desbordada
+    if(maxBytes)
+        overflow=false;
+}
+
+bool FrameWriter::commit(){
+    uint8_t length;
+
+    if(overflow)
+        return false;
+
+    ringTx[indexNBytes]=nBytes+1;
+    cheksum^=nBytes+1;
+    ringTx[indexData]=cheksum;
+    indexData=(indexData+1) & maskTx;
+
+    if(framingTx==FRAMINGCOBS){
+        length=cobsEncodeRing(ringTx, maskTx, indexFrame, nBytes+3);
+        *indexWriteTx=(indexFrame+length) & maskTx;
+    }else{
+        *indexWriteTx=indexData;
+    }
+    return true;
+}
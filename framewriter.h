@@ -0,0 +1,132 @@
+/*=============================================================================
+ * Copyright (c) 2021, Alejandro Rougier <alejandro.rougier@uner.edu.ar>
+ *
+ * All rights reserved.
+ * License: Free
+ * Date: 2021/11/12
+ * Version: v1.0
+ *===========================================================================*/
+
+/*==================[ Inclusions ]============================================*/
+
+#ifndef FRAMEWRITER_H
+#define FRAMEWRITER_H
+
+#include "mbed.h"
+#include "cobs.h"
+
+/*==================[ Global Variables ]============================================*/
+
+/**
+ * @brief Enumeración de los modos de entramado que se pueden negociar con SETFRAMING
+ *
+ */
+typedef enum{
+    FRAMINGUNER=0x00,   //!< Tramas con cabecera 'U','N','E','R' (modo por defecto)
+    FRAMINGCOBS=0x01    //!< Tramas codificadas con COBS y delimitadas por 0x00
+}_eFraming;
+
+/*==================[ Class Definitions ]============================================*/
+
+/**
+ * @brief Arma una trama directamente en el buffer circular de transmisión
+ * Los campos se agregan en little-endian y el cheksum se calcula a medida que se escriben.
+ * La trama recién es visible para quien transmite cuando se llama a commit().
+ * Nunca escribe sobre datos que todavía no se transmitieron: si la trama no entra en el espacio
+ * libre se descarta completa.
+ */
+class FrameWriter
+{
+    public:
+        /**
+         * @brief Construct a new Frame Writer object
+         *
+         * @param ring          Puntero al buffer circular de transmisión
+         * @param mask          Máscara del buffer circular (tamaño - 1)
+         * @param indexWrite    Puntero al indice de escritura del buffer circular
+         * @param indexRead     Puntero al indice de lectura del buffer circular
+         * @param framing       Entramado a utilizar (_eFraming)
+         */
+        FrameWriter(uint8_t *ring, uint8_t mask, uint8_t *indexWrite, const uint8_t *indexRead, uint8_t framing);
+        /**
+         * @brief Agrega un dato de tipo T en little-endian, el tamaño se conoce en compilación
+         *
+         * @tparam T    Tipo entero del dato
+         * @param value Valor a agregar
+         * @return FrameWriter&
+         */
+        template <typename T>
+        FrameWriter &put(T value){
+            for(uint8_t i=0; i<sizeof(T); i++){
+                u8((uint8_t)(value>>(8*i)));
+            }
+            return *this;
+        }
+        FrameWriter &u8(uint8_t value);
+        FrameWriter &u16(uint16_t value){ return put<uint16_t>(value); }
+        FrameWriter &u32(uint32_t value){ return put<uint32_t>(value); }
+        FrameWriter &i16(int16_t value){ return put<uint16_t>((uint16_t)value); }
+        FrameWriter &i32(int32_t value){ return put<uint32_t>((uint32_t)value); }
+        FrameWriter &f32(float value);
+        /**
+         * @brief Agrega un arreglo de bytes
+         *
+         * @param buff      Puntero a los datos
+         * @param length    Cantidad de bytes
+         * @return FrameWriter&
+         */
+        FrameWriter &array(const uint8_t *buff, uint8_t length);
+        /**
+         * @brief Cierra la trama: escribe NBYTES y el cheksum, codifica si corresponde y la publica
+         *
+         * @return true     La trama quedó en el buffer de transmisión
+         * @return false    La trama no entraba y se descartó completa
+         */
+        bool commit();
+        /**
+         * @brief Consulta si la trama ya no entra en el espacio libre del buffer
+         * 
+         * @return true     La trama se va a descartar en commit()
+         * @return false    Hasta ahora la trama entra
+         */
+        bool isOverflow(){ return overflow; }
+        /**
+         * @brief Bytes escritos después de ':', sirve como posición para patch() y truncate()
+         *
+         * @return uint8_t  Cantidad de bytes escritos
+         */
+        uint8_t length(){ return nBytes; }
+        /**
+         * @brief Bytes que todavía se pueden agregar sin desbordar la trama
+         *
+         * @return uint8_t  Bytes libres
+         */
+        uint8_t space(){ return (nBytes<maxBytes) ? maxBytes-nBytes : 0; }
+        /**
+         * @brief Reemplaza un byte ya escrito, por ejemplo una longitud que se conoce al final
+         *
+         * @param position  Posición obtenida con length() antes de escribir el byte
+         * @param value     Nuevo valor
+         */
+        void patch(uint8_t position, uint8_t value);
+        /**
+         * @brief Descarta lo escrito desde la posición indicada, si la trama se había desbordado vuelve a entrar
+         *
+         * @param position  Posición obtenida con length()
+         */
+        void truncate(uint8_t position);
+    private:
+        uint8_t *ringTx;            //!< Buffer circular de transmisión
+        uint8_t maskTx;             //!< Máscara del buffer circular
+        uint8_t *indexWriteTx;      //!< Indice de escritura que se publica en commit()
+        uint8_t framingTx;          //!< Entramado de la trama
+        uint8_t indexFrame;         //!< Inicio de la trama en el buffer
+        uint8_t indexNBytes;        //!< Posición del campo NBYTES
+        uint8_t indexData;          //!< Próxima posición a escribir
+        uint16_t nBytes;            //!< Bytes después de ':' sin contar el cheksum
+        uint8_t cheksum;            //!< Cheksum acumulado
+        uint16_t maxBytes;          //!< Máximo de bytes después de ':' que admite el entramado
+        bool overflow;              //!< La trama superó el tamaño admitido
+};
+
+#endif
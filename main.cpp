@@ -1,6 +1,13 @@
 #include "mbed.h"
 #include "wifi.h"
 #include "config.h"
+#include "cobs.h"
+#include "framewriter.h"
+#include "txqueue.h"
+#include "framepool.h"
+#include "rttstats.h"
+#include "capture.h"
+#include "compress.h"
 
 #define     RINGBUFFLENGTH      256
 
@@ -12,10 +19,20 @@
 
 #define     ALIVEAUTOINTERVAL   20000
 
+#define     TXFORWARDLIMIT      16
+
 #define     POSID               4
 
 #define     POSDATA             5
 
+#define     PAYLOADOVERHEAD     3   //!< Bytes de NBYTES que no son ID ni datos (0x01, 0x00 y cheksum)
+
+#define     UNERMAXNBYTES       (RINGBUFFLENGTH-1-6)    //!< NBYTES máximo para que la trama completa entre en el buffer de recepción
+
+#define     DELTAMAXSTRIDE      8
+
+#define     CAPTURECHUNK        64  //!< Bytes de captura por respuesta, tiene que entrar en un bloque del pool
+
 /**
  * @brief Enumeración de la MEF para decodificar el protocolo
  * 
@@ -30,8 +47,6 @@ typedef enum{
     PAYLOAD
 }_eProtocolo;
 
-_eProtocolo estadoProtocolo;
-
 /**
  * @brief Enumeración de la lista de comandos
  * 
@@ -40,9 +55,46 @@ typedef enum{
         ACK=0x0D,
         GETALIVE=0xF0,
         STARTCONFIG=0xEE,
+        SETFRAMING=0xE0,
+        WIFIINFO=0xE2,
+        SETCOMPRESSION=0xE3,
+        POOLSTATS=0xE4,
+        PING=0xE5,
+        RTTSTATS=0xE6,
+        RXSTATS=0xE7,
+        CAPTURE=0xE8,
+        COMPRESSED=0xC0,
+        BATCH=0xC1,
         OTHERS
 }_eID;
 
+/**
+ * @brief Resultado de un comando, cada subcomando de un BATCH lo devuelve en su respuesta
+ * En las tramas con un solo comando cualquier error se sigue respondiendo con 0xDD
+ */
+typedef enum{
+    STATUSOK=0x00,          //!< Ejecutado, la respuesta va a continuación
+    STATUSPENDING=0x01,     //!< Aceptado, la respuesta llega después en su propia trama (WIFIINFO)
+    STATUSUNKNOWN=0x02,     //!< ID desconocido
+    STATUSLENGTH=0x03,      //!< Faltan datos
+    STATUSARGUMENT=0x04,    //!< Dato fuera de rango
+    STATUSBUSY=0x05,        //!< No se puede atender ahora, reintentar
+    STATUSNOTBATCH=0x06,    //!< El comando no se puede enviar dentro de un BATCH
+    STATUSNOSPACE=0x07      //!< La respuesta no entraba, ni este subcomando ni los siguientes se ejecutaron
+}_eStatus;
+
+/**
+ * @brief Consultas que se pueden hacer con WIFIINFO, el índice es el byte de datos del comando
+ * 
+ */
+const char * const wifiInfoCommands[]={
+    "AT+CWJAP?\r\n",       //!< SSID, BSSID, canal y RSSI del AP
+    "AT+CIFSR\r\n",        //!< IP y MAC
+    "AT+CIPSTATUS\r\n"     //!< Estado de la conexión
+};
+
+#define WIFIINFOTIMEOUT     2000
+
 /**
  * @brief estructura de datos del Wifi para configurar la conexion
  * 
@@ -55,18 +107,53 @@ wifiData myWifiData;
  * 
  */
 typedef struct{
+    _eProtocolo estadoProtocolo; //!< Estado de la MEF que decodifica el protocolo
+    uint8_t nBytes;          //!< Bytes que faltan recibir de la trama en curso
     uint8_t timeOut;         //!< TiemOut para reiniciar la máquina si se interrumpe la comunicación
     uint8_t indexStart;      //!< Indice para saber en que parte del buffer circular arranca el ID
     uint8_t cheksumRx;       //!< Cheksumm RX
     uint8_t indexWriteRx;    //!< Indice de escritura del buffer circular de recepción
     uint8_t indexReadRx;     //!< Indice de lectura del buffer circular de recepción
-    uint8_t indexWriteTx;    //!< Indice de escritura del buffer circular de transmisión
-    uint8_t indexReadTx;     //!< Indice de lectura del buffer circular de transmisión
+    uint8_t framing;         //!< Modo de entramado activo (_eFraming)
+    uint8_t indexScan;       //!< Indice hasta donde se decodificó, indexReadRx queda en el comienzo de la trama en curso
+    uint8_t compress;        //!< El otro extremo acepta tramas COMPRESSED
+    uint8_t compressStride;  //!< Paso de la codificación delta de las tramas que se comprimen
     uint8_t bufferRx[RINGBUFFLENGTH];   //!< Buffer circular de recepción
-    uint8_t bufferTx[RINGBUFFLENGTH];   //!< Buffer circular de transmisión
+    _sTxQueue tx;            //!< Colas de transmisión por prioridad
+    _sRttStats rtt;          //!< RTT que informa el otro extremo en cada PING
+    uint16_t rxOverruns;     //!< Bytes descartados por buffer de recepción lleno (solo el puerto serie, el Wifi los cuenta en la clase)
+    uint8_t unerMatch;       //!< Bytes reconocidos de un SETFRAMING en UNER mientras el canal está en COBS
+    uint8_t unerFraming;     //!< Entramado que pide ese SETFRAMING
 }_sDato ;
 
- _sDato datosComSerie, datosComWifi;
+/**
+ * @brief Comienzo de una trama UNER con SETFRAMING, siguen el entramado y el cheksum
+ * En modo COBS se sigue reconociendo para que un otro extremo que no sabe en qué modo está el canal pueda volver a UNER
+ */
+const uint8_t unerSetFraming[]={'U','N','E','R',0x05,':',0x01,0x00,SETFRAMING};
+
+ _sDato datosComSerie, datosComWifi[WIFIMODULES];
+
+/**
+ * @brief Bloques de transmisión compartidos por todos los canales
+ * El canal que está transmitiendo más puede usar los bloques que los demás no necesitan
+ */
+_sFramePool framePool;
+
+#if CAPTUREENABLE
+/**
+ * @brief Captura del tráfico de los puertos serie, se controla y se lee con el comando CAPTURE
+ * 
+ */
+_sCapture capture;
+#endif
+
+/**
+ * @brief Buffer donde se descomprimen las tramas COMPRESSED antes de procesarlas
+ * Tiene el mismo tamaño que los buffers de recepción para que los comandos lo recorran igual. Se llena hasta
+ * 255 bytes porque la longitud del comando es de 8 bits
+ */
+uint8_t bufferUncompressed[RINGBUFFLENGTH];
 
 
 /**
@@ -119,12 +206,146 @@ void onDataRx(void);
  */
 void decodeProtocol(_sDato *);
 
+/**
+ * @brief Decodifica las tramas con cabecera UNER que se reciben
+ * Se detiene después de una trama que cambió el entramado, así lo que sigue lo decodifica el nuevo modo.
+ */
+void decodeUner(_sDato *);
+
+/**
+ * @brief Decodifica las tramas COBS que se reciben
+ * Busca el delimitador 0x00 en los tramos contiguos del buffer circular, decodifica la trama
+ * sobre el mismo buffer y, si el cheksum es correcto, la procesa. Una trama dañada solo
+ * descarta los bytes hasta el siguiente delimitador. Se detiene después de una trama que cambió el entramado.
+ * Un SETFRAMING en UNER con el cheksum correcto también se ejecuta, con la respuesta en UNER.
+ */
+void decodeCobs(_sDato *);
+
+/**
+ * @brief Avanza el reconocimiento de un SETFRAMING en UNER con el byte recibido
+ * 
+ * @param datosCom Canal en modo COBS
+ * @param dato Byte recibido
+ * @return true El byte completó la trama y el cheksum es correcto, el entramado pedido queda en unerFraming
+ */
+bool matchUnerSetFraming(_sDato *datosCom, uint8_t dato);
+
 /**
  * @brief Procesa el comando (ID) que se recibió
  * Si el protocolo es correcto, se llama a esta función para procesar el comando
  */
 void decodeData(_sDato *);
 
+/**
+ * @brief Ejecuta un comando
+ * 
+ * @param datosCom Canal por donde llegó el comando
+ * @param buff Buffer de 256 bytes donde está el comando, se recorre con índices de 8 bits
+ * @param indexId Posición del ID en buff
+ * @param length Cantidad de bytes del ID y los datos
+ */
+void executeCommand(_sDato *datosCom, const uint8_t *buff, uint8_t indexId, uint8_t length);
+
+/**
+ * @brief Ejecuta un comando y agrega a la respuesta lo que va después del ID
+ * 
+ * @param datosCom Canal por donde llegó el comando
+ * @param buff Buffer de 256 bytes donde está el comando, se recorre con índices de 8 bits
+ * @param indexId Posición del ID en buff
+ * @param length Cantidad de bytes del ID y los datos
+ * @param reply Respuesta en construcción, con el ID ya escrito
+ * @param newFraming Entramado a usar después de enviar la respuesta
+ * @return uint8_t Resultado (_eStatus), si no es STATUSOK lo escrito en reply no sirve
+ */
+uint8_t runCommand(_sDato *datosCom, const uint8_t *buff, uint8_t indexId, uint8_t length, FrameWriter &reply, uint8_t *newFraming);
+
+/**
+ * @brief Ejecuta en orden los subcomandos de una trama BATCH y arma una sola respuesta
+ * Cada subcomando es [longitud][ID][datos] y cada respuesta [longitud][ID][estado][respuesta], en ambos casos la
+ * longitud cuenta los bytes que le siguen. Antes de ejecutar cada subcomando se verifica que su respuesta entre en
+ * la trama; si no entra se informa STATUSNOSPACE sin ejecutarlo y no se ejecuta lo que sigue.
+ * 
+ * @param datosCom Canal por donde llegó el comando
+ * @param buff Buffer de 256 bytes donde está el comando, se recorre con índices de 8 bits
+ * @param indexId Posición del ID BATCH en buff
+ * @param length Cantidad de bytes del ID y los datos
+ * @param reply Respuesta en construcción
+ * @param newFraming Entramado a usar después de enviar la respuesta
+ */
+void executeBatch(_sDato *datosCom, const uint8_t *buff, uint8_t indexId, uint8_t length, FrameWriter &reply, uint8_t *newFraming);
+
+/**
+ * @brief Máximo de bytes que runCommand() agrega a la respuesta del comando
+ * 
+ * @param id ID del comando
+ * @return uint8_t Bytes después del ID, CAPTURE lectura se adapta al lugar que queda
+ */
+uint8_t replyLength(uint8_t id);
+
+/**
+ * @brief Lee un uint32_t little-endian de un buffer de 256 bytes
+ * 
+ * @param buff Buffer, se recorre con índices de 8 bits
+ * @param index Posición del primer byte
+ * @return uint32_t Valor leído
+ */
+uint32_t readU32(const uint8_t *buff, uint8_t index);
+
+/**
+ * @brief Encola una trama con el payload (ID y datos) indicado
+ * Si el otro extremo habilitó la compresión y el payload se achica, viaja como COMPRESSED
+ * 
+ * @param datosCom Canal por donde enviar
+ * @param txClass Clase de prioridad de la trama (_eTxClass)
+ * @param payload ID seguido de los datos
+ * @param length Longitud del payload
+ * @return true La trama quedó encolada
+ * @return false La trama se descartó completa
+ */
+bool sendPayload(_sDato *datosCom, uint8_t txClass, const uint8_t *payload, uint8_t length);
+
+
+/**
+ * @brief Publica una trama armada con txQueueWriter() en la cola de su clase
+ * 
+ * @param datosCom Canal donde se armó la trama
+ * @param txClass Clase de prioridad de la trama (_eTxClass)
+ * @param frame Trama a publicar
+ * @return true La trama quedó encolada
+ * @return false La trama se descartó completa
+ */
+bool commitFrame(_sDato *datosCom, uint8_t txClass, FrameWriter &frame);
+
+/**
+ * @brief Tipo de operación del comando CAPTURE
+ * 
+ */
+typedef enum{
+    CAPTURESTOP,        //!< Detiene la captura
+    CAPTURESTART,       //!< Vacía el buffer y arranca la captura
+    CAPTUREREAD         //!< Detiene la captura y saca hasta CAPTURECHUNK bytes de registros completos
+}_eCaptureOp;
+
+/**
+ * @brief Registra en la captura los bytes que pasan por el puerto de un ESP
+ * 
+ * @param wifi Módulo por donde pasó el byte
+ * @param tx true si se transmitió
+ * @param dato Byte
+ */
+#if CAPTUREENABLE
+void onWifiCapture(Wifi *wifi, bool tx, uint8_t dato);
+#endif
+
+/**
+ * @brief Envía la respuesta de WIFIINFO cuando el ESP termina el comando AT
+ * 
+ * @param datosCom Canal por donde llegó la consulta
+ * @param status Resultado del comando (_eAtStatus)
+ * @param response Respuesta del ESP
+ * @param length Longitud de la respuesta
+ */
+void onWifiInfo(_sDato *datosCom, uint8_t status, const uint8_t *response, uint8_t length);
 
 /**
  * @brief  Función Hearbeat
@@ -139,9 +360,17 @@ void hearbeatTask(uint32_t *generalTime);
  * @brief Rutina para revisar los buffers de comunicación, decodificar y transmitar según sea necesario
  * 
  * @param datosCom Puntero a la estructura de datos del buffer
- * @param source flag que indica el módulo a donde transmitir
+ * @param wifi Módulo Wifi por donde transmitir, NULL para transmitir por el puerto serie
  */
-void comunicationsTask(_sDato *datosCom, uint8_t source);
+void comunicationsTask(_sDato *datosCom, Wifi *wifi);
+
+/**
+ * @brief Elige el módulo Wifi por donde sale la próxima trama que genera el equipo
+ * Reparte las tramas entre los módulos listos y sin congestión de forma rotativa
+ * 
+ * @return int8_t índice del módulo elegido, -1 si ninguno puede transmitir
+ */
+int8_t selectWifi(void);
 
 /**
  * @brief Envía el Alive de manera automática cuando el WIFI esta conectado
@@ -160,6 +389,33 @@ void autoConnectWifi(void);
 /*****************************************************************************************************/
 /* Configuración del Microcontrolador */
 
+/**
+ * @brief Verifica en compilación que ningún pin de la lista esté repetido
+ * 
+ */
+constexpr bool pinsDistinct(const PinName *pins, uint8_t count)
+{
+    for(uint8_t i=0; i<count; i++){
+        for(uint8_t j=i+1; j<count; j++){
+            if(pins[i]==pins[j])
+                return false;
+        }
+    }
+    return true;
+}
+
+constexpr PinName usedPins[]={
+    PC_13, PA_9, PA_10, WIFITX0, WIFIRX0, WIFICHPD0,
+#if WIFIFLOWCONTROL
+    WIFIRTS0, WIFICTS0,
+#endif
+#if WIFIMODULES > 1
+    WIFITX1, WIFIRX1, WIFICHPD1,
+#endif
+};
+
+static_assert(pinsDistinct(usedPins, sizeof(usedPins)/sizeof(usedPins[0])), "config.h: hay pines repetidos entre el LED, el puerto serie y los ESP");
+
 DigitalOut HEARBEAT(PC_13); //!< Defino la salida del led
 
 RawSerial pcCom(PA_9,PA_10,115200); //!< Configuración del puerto serie, la velocidad (115200) tiene que ser la misma en QT
@@ -167,11 +423,36 @@ RawSerial pcCom(PA_9,PA_10,115200); //!< Configuración del puerto serie, la vel
 Timer miTimer; //!< Timer general
 
 
+RawSerial wifiCom0(WIFITX0,WIFIRX0,115200); //!< Puerto serie del primer ESP
+
+DigitalOut chipEnableESP0(WIFICHPD0); //!< CH_PD del primer ESP
+
+#if WIFIFLOWCONTROL
+DigitalOut rtsESP0(WIFIRTS0, 0); //!< RTS del primer ESP
+#endif
+
+#if WIFIMODULES > 1
+RawSerial wifiCom1(WIFITX1,WIFIRX1,115200); //!< Puerto serie del segundo ESP
+
+DigitalOut chipEnableESP1(WIFICHPD1); //!< CH_PD del segundo ESP
+#endif
+
 /**
- * @brief Instanciación de la clase Wifi, le paso como parametros el buffer de recepción, el indice de 
- * escritura para el buffer de recepción y el tamaño del buffer de recepción
+ * @brief Instanciación de la clase Wifi, le paso como parametros el puerto serie, el CH_PD, el buffer de recepción, 
+ * el indice de escritura para el buffer de recepción y el tamaño del buffer de recepción
  */
-Wifi myWifi(datosComWifi.bufferRx,&datosComWifi.indexWriteRx, sizeof(datosComWifi.bufferRx));
+Wifi myWifi0(wifiCom0, chipEnableESP0, datosComWifi[0].bufferRx, &datosComWifi[0].indexWriteRx, &datosComWifi[0].indexReadRx, sizeof(datosComWifi[0].bufferRx));
+
+#if WIFIMODULES > 1
+Wifi myWifi1(wifiCom1, chipEnableESP1, datosComWifi[1].bufferRx, &datosComWifi[1].indexWriteRx, &datosComWifi[1].indexReadRx, sizeof(datosComWifi[1].bufferRx));
+#endif
+
+Wifi *wifiModules[WIFIMODULES]={
+    &myWifi0,
+#if WIFIMODULES > 1
+    &myWifi1,
+#endif
+};
 
 /*****************************************************************************************************/
 /*********************************  Función Principal ************************************************/
@@ -182,18 +463,44 @@ int main()
 
     miTimer.start();
 
+#if CAPTUREENABLE
+    captureInit(&capture, &miTimer);
+#if CAPTUREATBOOT
+    captureStart(&capture);
+#endif
+#endif
+
+    framePoolInit(&framePool);
+    txQueueInit(&datosComSerie.tx, &framePool);
+    rttStatsInit(&datosComSerie.rtt);
+    for(uint8_t i=0; i<WIFIMODULES; i++){
+        txQueueInit(&datosComWifi[i].tx, &framePool);
+        rttStatsInit(&datosComWifi[i].rtt);
+    }
+
     pcCom.attach(&onDataRx,RawSerial::RxIrq);
 
-    myWifi.initTask();
+#if WIFIFLOWCONTROL
+    myWifi0.enableFlowControl(&rtsESP0, WIFICTS0);
+#endif
+
+    for(uint8_t i=0; i<WIFIMODULES; i++){
+#if CAPTUREENABLE
+        wifiModules[i]->attachCapture(callback(onWifiCapture, wifiModules[i]));
+#endif
+        wifiModules[i]->initTask();
+    }
 
     autoConnectWifi();
     
     while(true)
     {
-        myWifi.taskWifi();
+        for(uint8_t i=0; i<WIFIMODULES; i++)
+            wifiModules[i]->taskWifi();
         hearbeatTask(&generalTime);
-        comunicationsTask(&datosComSerie,true);
-        comunicationsTask(&datosComWifi,false);
+        comunicationsTask(&datosComSerie,NULL);
+        for(uint8_t i=0; i<WIFIMODULES; i++)
+            comunicationsTask(&datosComWifi[i],wifiModules[i]);
         aliveAutoTask(&aliveAutoTime);        
     }
     return 0;
@@ -205,136 +512,490 @@ int main()
 /************  MEF para decodificar el protocolo serie ***********************/
 void decodeProtocol(_sDato *datosCom)
 {
-    static uint8_t nBytes=0;
+    uint8_t framing;
+
+    // Un SETFRAMING puede llegar seguido de tramas en el modo nuevo dentro del mismo buffer
+    do{
+        framing=datosCom->framing;
+        if(framing==FRAMINGCOBS)
+            decodeCobs(datosCom);
+        else
+            decodeUner(datosCom);
+    }while(datosCom->framing!=framing);
+}
+
+void decodeUner(_sDato *datosCom)
+{
     uint8_t indexWriteRxCopy=datosCom->indexWriteRx;
 
-    while (datosCom->indexReadRx!=indexWriteRxCopy)
+    // Se recorre con indexScan. indexReadRx, que es lo que respeta la interrupción de recepción, recién avanza cuando
+    // se descartan bytes o cuando decodeData() terminó de usar la trama
+    while (datosCom->indexScan!=indexWriteRxCopy)
     {
-        switch (estadoProtocolo) {
+        switch (datosCom->estadoProtocolo) {
             case START:
-                if (datosCom->bufferRx[datosCom->indexReadRx++]=='U'){
-                    estadoProtocolo=HEADER_1;
+                datosCom->indexReadRx=datosCom->indexScan;
+                if (datosCom->bufferRx[datosCom->indexScan++]=='U'){
+                    datosCom->estadoProtocolo=HEADER_1;
                     datosCom->cheksumRx=0;
                 }
                 break;
             case HEADER_1:
-                if (datosCom->bufferRx[datosCom->indexReadRx++]=='N')
-                   estadoProtocolo=HEADER_2;
+                if (datosCom->bufferRx[datosCom->indexScan++]=='N')
+                   datosCom->estadoProtocolo=HEADER_2;
                 else{
-                    datosCom->indexReadRx--;
-                    estadoProtocolo=START;
+                    datosCom->indexScan--;
+                    datosCom->estadoProtocolo=START;
                 }
                 break;
             case HEADER_2:
-                if (datosCom->bufferRx[datosCom->indexReadRx++]=='E')
-                    estadoProtocolo=HEADER_3;
+                if (datosCom->bufferRx[datosCom->indexScan++]=='E')
+                    datosCom->estadoProtocolo=HEADER_3;
                 else{
-                    datosCom->indexReadRx--;
-                   estadoProtocolo=START;
+                    datosCom->indexScan--;
+                   datosCom->estadoProtocolo=START;
                 }
                 break;
         case HEADER_3:
-            if (datosCom->bufferRx[datosCom->indexReadRx++]=='R')
-                estadoProtocolo=NBYTES;
+            if (datosCom->bufferRx[datosCom->indexScan++]=='R')
+                datosCom->estadoProtocolo=NBYTES;
             else{
-                datosCom->indexReadRx--;
-               estadoProtocolo=START;
+                datosCom->indexScan--;
+               datosCom->estadoProtocolo=START;
             }
             break;
             case NBYTES:
-                datosCom->indexStart=datosCom->indexReadRx;
-                nBytes=datosCom->bufferRx[datosCom->indexReadRx++];
-               estadoProtocolo=TOKEN;
+                datosCom->indexStart=datosCom->indexScan;
+                datosCom->nBytes=datosCom->bufferRx[datosCom->indexScan++];
+                // Una trama más larga que el buffer nunca se completaría: la interrupción descartaría lo que falta.
+                // Con 0 el contador del payload daría la vuelta y se esperaría una trama de 255 bytes
+                if((datosCom->nBytes<1) || (datosCom->nBytes>UNERMAXNBYTES)){
+                    datosCom->indexScan--;
+                    datosCom->estadoProtocolo=START;
+                }else{
+                    datosCom->estadoProtocolo=TOKEN;
+                }
                 break;
             case TOKEN:
-                if (datosCom->bufferRx[datosCom->indexReadRx++]==':'){
-                   estadoProtocolo=PAYLOAD;
-                    datosCom->cheksumRx ='U'^'N'^'E'^'R'^ nBytes^':';
+                if (datosCom->bufferRx[datosCom->indexScan++]==':'){
+                   datosCom->estadoProtocolo=PAYLOAD;
+                    datosCom->cheksumRx ='U'^'N'^'E'^'R'^ datosCom->nBytes^':';
                 }
                 else{
-                    datosCom->indexReadRx--;
-                    estadoProtocolo=START;
+                    datosCom->indexScan--;
+                    datosCom->estadoProtocolo=START;
                 }
                 break;
             case PAYLOAD:
-                if (nBytes>1){
-                    datosCom->cheksumRx ^= datosCom->bufferRx[datosCom->indexReadRx++];
+                if (datosCom->nBytes>1){
+                    datosCom->cheksumRx ^= datosCom->bufferRx[datosCom->indexScan++];
                 }
-                nBytes--;
-                if(nBytes<=0){
-                    estadoProtocolo=START;
-                    if(datosCom->cheksumRx == datosCom->bufferRx[datosCom->indexReadRx]){
+                datosCom->nBytes--;
+                if(datosCom->nBytes<=0){
+                    datosCom->estadoProtocolo=START;
+                    if(datosCom->cheksumRx == datosCom->bufferRx[datosCom->indexScan]){
+                        datosCom->indexScan++;
                         decodeData(datosCom); 
+                        datosCom->indexReadRx=datosCom->indexScan;
+                        if(datosCom->framing!=FRAMINGUNER)
+                            return;
                     }
                 }
                
                 break;
             default:
-                estadoProtocolo=START;
+                datosCom->estadoProtocolo=START;
                 break;
         }
     }
+    if(datosCom->estadoProtocolo==START)
+        datosCom->indexReadRx=datosCom->indexScan;
+}
+
+
+/*****************************************************************************************************/
+/************  Decodificación de tramas COBS ***********************/
+void decodeCobs(_sDato *datosCom)
+{
+    uint8_t indexWriteRxCopy=datosCom->indexWriteRx, length, nBytes, cheksum, command[2];
+    uint16_t indexEnd;
+    bool unerFrame=false;
+
+    // Si llega un SETFRAMING en UNER solo se decodifica en COBS lo anterior, lo que sigue puede venir en UNER
+    for(uint8_t index=datosCom->indexScan; index!=indexWriteRxCopy; index++){
+        if(matchUnerSetFraming(datosCom, datosCom->bufferRx[index])){
+            indexWriteRxCopy=index+1;
+            unerFrame=true;
+            break;
+        }
+    }
+
+    while(cobsFindDelimiter(datosCom->bufferRx, RINGBUFFLENGTH, datosCom->indexScan, indexWriteRxCopy, &indexEnd)){
+        length=(uint8_t)indexEnd-datosCom->indexReadRx;
+        if((length>1) && (length<=(COBSMAXFRAME+1)) && 
+            (length=cobsDecodeRing(datosCom->bufferRx, RINGBUFFLENGTH-1, datosCom->indexReadRx, length))){
+            nBytes=datosCom->bufferRx[datosCom->indexReadRx];
+            if((length==(uint8_t)(nBytes+2)) && (datosCom->bufferRx[(uint8_t)(datosCom->indexReadRx+1)]==':')){
+                cheksum='U'^'N'^'E'^'R';
+                for(uint8_t a=0; a<(length-1); a++)
+                    cheksum ^= datosCom->bufferRx[(uint8_t)(datosCom->indexReadRx+a)];
+                if(cheksum==datosCom->bufferRx[(uint8_t)(datosCom->indexReadRx+length-1)]){
+                    datosCom->indexStart=datosCom->indexReadRx;
+                    decodeData(datosCom);
+                }
+            }
+        }
+        datosCom->indexReadRx=datosCom->indexScan=(uint8_t)indexEnd+1;
+        if(datosCom->framing!=FRAMINGCOBS){
+            datosCom->estadoProtocolo=START;
+            datosCom->unerMatch=0;
+            return;
+        }
+    }
+    datosCom->indexScan=indexWriteRxCopy;
+    if(unerFrame){
+        // Quien lo envió habla UNER: la respuesta va en UNER y el canal queda en UNER salvo que pida COBS
+        datosCom->indexReadRx=indexWriteRxCopy;
+        datosCom->estadoProtocolo=START;
+        datosCom->framing=FRAMINGUNER;
+        command[0]=SETFRAMING;
+        command[1]=datosCom->unerFraming;
+        executeCommand(datosCom, command, 0, sizeof(command));
+        return;
+    }
+    // Sin delimitador a la vista no puede haber una trama válida más larga que COBSMAXFRAME
+    if((uint8_t)(indexWriteRxCopy-datosCom->indexReadRx)>(COBSMAXFRAME+1))
+        datosCom->indexReadRx=indexWriteRxCopy;
+}
+
+
+bool matchUnerSetFraming(_sDato *datosCom, uint8_t dato)
+{
+    uint8_t cheksum;
+
+    if(datosCom->unerMatch<sizeof(unerSetFraming)){
+        if(dato==unerSetFraming[datosCom->unerMatch])
+            datosCom->unerMatch++;
+        else
+            datosCom->unerMatch=(dato==unerSetFraming[0]) ? 1 : 0;
+        return false;
+    }
+    if(datosCom->unerMatch==sizeof(unerSetFraming)){
+        datosCom->unerFraming=dato;
+        datosCom->unerMatch++;
+        return false;
+    }
+    datosCom->unerMatch=(dato==unerSetFraming[0]) ? 1 : 0;
+    cheksum=datosCom->unerFraming;
+    for(uint8_t i=0; i<sizeof(unerSetFraming); i++)
+        cheksum ^= unerSetFraming[i];
+    return dato==cheksum;
 }
 
 
 /*****************************************************************************************************/
 /************  Función para procesar el comando recibido ***********************/
 void decodeData(_sDato *datosCom)
+{
+    // Sin al menos el ID la longitud daría la vuelta y los comandos leerían bytes viejos del buffer
+    if(datosCom->bufferRx[datosCom->indexStart]<(PAYLOADOVERHEAD+1))
+        return;
+    executeCommand(datosCom, datosCom->bufferRx, datosCom->indexStart+POSID, datosCom->bufferRx[datosCom->indexStart]-PAYLOADOVERHEAD);
+}
+
+void executeCommand(_sDato *datosCom, const uint8_t *buff, uint8_t indexId, uint8_t length)
+{
+    uint8_t newFraming=datosCom->framing, stride, status, indexReply;
+    uint16_t lengthUncompressed=0;
+    FrameWriter reply=txQueueWriter(&datosCom->tx, TXCONTROL, datosCom->framing);
+
+    reply.u8(0x01).u8(0x00);
+
+    switch (buff[indexId]) {
+        case COMPRESSED: //Se descomprime y se procesa el comando que lleva adentro, datos: paso delta y payload comprimido
+            stride=buff[(uint8_t)(indexId+1)];
+            if((buff!=bufferUncompressed) && (length>2) && (stride<=DELTAMAXSTRIDE))
+                lengthUncompressed=lzDecompress(buff, RINGBUFFLENGTH-1, indexId+2, length-2, stride, bufferUncompressed, sizeof(bufferUncompressed)-1);
+            // Un COMPRESSED dentro de otro no se acepta, así la descompresión queda acotada a una por trama
+            if(lengthUncompressed && (bufferUncompressed[0]!=COMPRESSED)){
+                // La respuesta la arma el comando de adentro, el bloque de esta vuelve al pool
+                txQueueAbort(&datosCom->tx, TXCONTROL);
+                executeCommand(datosCom, bufferUncompressed, 0, lengthUncompressed);
+                return;
+            }
+            reply.u8(COMPRESSED).u8(0xDD);
+            break;
+        case BATCH:
+            executeBatch(datosCom, buff, indexId, length, reply, &newFraming);
+            break;
+        default:
+            indexReply=reply.length();
+            reply.u8(buff[indexId]);
+            status=runCommand(datosCom, buff, indexId, length, reply, &newFraming);
+            if(status==STATUSPENDING){
+                txQueueAbort(&datosCom->tx, TXCONTROL);
+                return;
+            }
+            // Respuestas de siempre: ID desconocido solo 0xDD, cualquier otro error ID y 0xDD
+            if(status==STATUSUNKNOWN){
+                reply.truncate(indexReply);
+                reply.u8(0xDD);
+            }else if(status!=STATUSOK){
+                reply.u8(0xDD);
+            }
+            break;
+    }
+    commitFrame(datosCom, TXCONTROL, reply);
+
+    // decodeProtocol() sigue con lo que quede en el buffer usando el entramado nuevo
+    datosCom->framing=newFraming;
+}
+
+void executeBatch(_sDato *datosCom, const uint8_t *buff, uint8_t indexId, uint8_t length, FrameWriter &reply, uint8_t *newFraming)
+{
+    uint8_t index=1, subLength, id, status, indexEntry, indexBody;
+
+    reply.u8(BATCH);
+    while(index<length){
+        subLength=buff[(uint8_t)(indexId+index)];
+        indexEntry=reply.length();
+        // Un subcomando que no entra en la trama no tiene un ID confiable, se informa con el ID BATCH y se termina
+        if((subLength==0) || (subLength>=(length-index))){
+            reply.u8(2).u8(BATCH).u8(STATUSLENGTH);
+            if(reply.isOverflow())
+                reply.truncate(indexEntry);
+            break;
+        }
+        id=buff[(uint8_t)(indexId+index+1)];
+        reply.u8(0).u8(id).u8(STATUSOK);
+        indexBody=reply.length();
+        if(reply.isOverflow()){
+            reply.truncate(indexEntry);
+            break;
+        }
+        // Un comando ejecutado cuya respuesta se pierde se repetiría si el otro extremo reintenta
+        if((id==BATCH) || (id==COMPRESSED))
+            status=STATUSNOTBATCH;
+        else if(reply.space()<replyLength(id))
+            status=STATUSNOSPACE;
+        else
+            status=runCommand(datosCom, buff, indexId+index+1, subLength, reply, newFraming);
+        if((status!=STATUSOK) && (status!=STATUSPENDING))
+            reply.truncate(indexBody);
+        reply.patch(indexEntry, reply.length()-indexEntry-1);
+        reply.patch(indexEntry+2, status);
+        if(status==STATUSNOSPACE)
+            break;
+        index+=subLength+1;
+    }
+}
+
+uint8_t replyLength(uint8_t id)
+{
+    switch(id){
+        case GETALIVE:
+        case STARTCONFIG:
+        case SETFRAMING:
+        case SETCOMPRESSION:
+            return 1;
+        case POOLSTATS:
+            return 5+2*TXCLASSES;
+        case PING:
+            return 12;
+        case RTTSTATS:
+            return 19;
+        case RXSTATS:
+            return 2;
+#if CAPTUREENABLE
+        case CAPTURE:
+            // Operación, descartados y cantidad, más lugar para al menos un registro: con cantidad 0 el otro
+            // extremo deja de leer
+            return 4+CAPTURERECORDMAX;
+#endif
+        default:
+            return 0;
+    }
+}
+
+uint8_t runCommand(_sDato *datosCom, const uint8_t *buff, uint8_t indexId, uint8_t length, FrameWriter &reply, uint8_t *newFraming)
 {
     wifiData *wifidataPtr;
     uint8_t *ptr; 
-    uint8_t auxBuffTx[50], indiceAux=0, cheksum, sizeWifiData, indexBytesToCopy=0, numBytesToCopy=0;
-    
-    auxBuffTx[indiceAux++]='U';
-    auxBuffTx[indiceAux++]='N';
-    auxBuffTx[indiceAux++]='E';
-    auxBuffTx[indiceAux++]='R';
-    auxBuffTx[indiceAux++]=0;
-    auxBuffTx[indiceAux++]=':';
-    auxBuffTx[indiceAux++]=0x01;
-    auxBuffTx[indiceAux++]=0x00;
-
-    switch (datosCom->bufferRx[datosCom->indexStart+POSID]) {
+    uint8_t sizeWifiData, indexBytesToCopy=0, numBytesToCopy=0;
+    uint8_t indexWifi, infoType, stride, framing;
+    uint32_t timeRx;
+    _sRttSummary rttSummary;
+#if CAPTUREENABLE
+    uint8_t chunk[CAPTURECHUNK], chunkLength;
+#endif
+
+    switch (buff[indexId]) {
         case GETALIVE:
-            auxBuffTx[indiceAux++]=GETALIVE;
-            auxBuffTx[indiceAux++]=ACK;
-            auxBuffTx[NBYTES]=0x05;         
+            reply.u8(ACK);
             break;
         case STARTCONFIG: //Inicia Configuración del wifi 
-            auxBuffTx[indiceAux++]=STARTCONFIG;
-            auxBuffTx[indiceAux++]=ACK;
-            auxBuffTx[NBYTES]=0x05;     
-            myWifi.resetWifi();
             sizeWifiData =sizeof(myWifiData);
-            indexBytesToCopy=datosCom->indexStart+POSDATA;
+            if(length<=sizeWifiData)
+                return STATUSLENGTH;
+            reply.u8(ACK);
+            indexBytesToCopy=indexId+1;
             wifidataPtr=&myWifiData;
 
             if ((RINGBUFFLENGTH - indexBytesToCopy)<sizeWifiData){
                 numBytesToCopy=RINGBUFFLENGTH-indexBytesToCopy;
-                memcpy(wifidataPtr,&datosCom->bufferRx[indexBytesToCopy], numBytesToCopy);
+                memcpy(wifidataPtr,&buff[indexBytesToCopy], numBytesToCopy);
                 indexBytesToCopy+=numBytesToCopy;
                 sizeWifiData-=numBytesToCopy;
                 ptr= (uint8_t *)wifidataPtr + numBytesToCopy;
-                memcpy(ptr,&datosCom->bufferRx[indexBytesToCopy], sizeWifiData);
+                memcpy(ptr,&buff[indexBytesToCopy], sizeWifiData);
             }else{
-                memcpy(&myWifiData,&datosCom->bufferRx[indexBytesToCopy], sizeWifiData);
+                memcpy(&myWifiData,&buff[indexBytesToCopy], sizeWifiData);
+            }
+            for(uint8_t i=0; i<WIFIMODULES; i++){
+                wifiModules[i]->resetWifi();
+                wifiModules[i]->configWifi(&myWifiData);
             }
-            myWifi.configWifi(&myWifiData);
             break;
-        
-        default:
-            auxBuffTx[indiceAux++]=0xDD;
-            auxBuffTx[NBYTES]=0x04;
+        case SETFRAMING: //Cambia el entramado, la respuesta viaja todavía con el modo anterior
+            if(length<2)
+                return STATUSLENGTH;
+            framing=buff[(uint8_t)(indexId+1)];
+            if((framing!=FRAMINGUNER) && (framing!=FRAMINGCOBS))
+                return STATUSARGUMENT;
+            *newFraming=framing;
+            reply.u8(ACK);
+            break;
+        case WIFIINFO: //La respuesta se envía cuando el ESP termina el comando
+            if(length<2)
+                return STATUSLENGTH;
+            indexWifi=0;
+            if((datosCom>=datosComWifi) && (datosCom<&datosComWifi[WIFIMODULES]))
+                indexWifi=datosCom-datosComWifi;
+            infoType=buff[(uint8_t)(indexId+1)];
+            if(infoType>=(sizeof(wifiInfoCommands)/sizeof(wifiInfoCommands[0])))
+                return STATUSARGUMENT;
+            if(!wifiModules[indexWifi]->sendATCommand(wifiInfoCommands[infoType], WIFIINFOTIMEOUT, callback(onWifiInfo, datosCom)))
+                return STATUSBUSY;
+            return STATUSPENDING;
+        case SETCOMPRESSION: //Habilita las tramas COMPRESSED hacia el otro extremo, datos: habilitación y paso delta
+            if(length<3)
+                return STATUSLENGTH;
+            stride=buff[(uint8_t)(indexId+2)];
+            if(stride>DELTAMAXSTRIDE)
+                return STATUSARGUMENT;
+            datosCom->compress=buff[(uint8_t)(indexId+1)]!=0;
+            datosCom->compressStride=stride;
+            reply.u8(ACK);
+            break;
+        case POOLSTATS: //Bloques totales, en uso, máximo en uso, pedidos fallidos y tramas descartadas por clase en este canal
+            reply.u8(FRAMEPOOLBLOCKS).u8(framePool.used).u8(framePool.highWater).u16(framePool.fails);
+            for(uint8_t i=0; i<TXCLASSES; i++)
+                reply.u16(datosCom->tx.txClass[i].drops);
+            break;
+        case PING: //Datos: marca de tiempo del otro extremo y, opcional, el RTT que midió en el PING anterior (us, 0 si no hay)
+            timeRx=miTimer.read_us();
+            if(length<5)
+                return STATUSLENGTH;
+            if((length>=9) && readU32(buff, indexId+5))
+                rttStatsAdd(&datosCom->rtt, readU32(buff, indexId+5));
+            // Se devuelve la marca sin interpretarla, con el momento en que se procesó la trama y en que se armó la respuesta
+            reply.u32(readU32(buff, indexId+1)).u32(timeRx).u32(miTimer.read_us());
+            break;
+        case RTTSTATS: //Muestras totales y en la ventana, mínimo, promedio, máximo y percentil RTTPERCENTILE en us
+            rttStatsCompute(&datosCom->rtt, &rttSummary);
+            reply.u16(datosCom->rtt.total).u8(datosCom->rtt.count);
+            reply.u32(rttSummary.min).u32(rttSummary.avg).u32(rttSummary.max).u32(rttSummary.percentile);
+            break;
+        case RXSTATS: //Bytes descartados por buffer de recepción lleno en este canal
+            if((datosCom>=datosComWifi) && (datosCom<&datosComWifi[WIFIMODULES]))
+                reply.u16(wifiModules[datosCom-datosComWifi]->getRxOverruns());
+            else
+                reply.u16(datosCom->rxOverruns);
+            break;
+#if CAPTUREENABLE
+        case CAPTURE: //Datos: operación (_eCaptureOp). La lectura devuelve registros descartados (u16), cantidad de bytes y los registros
+            if(length<2)
+                return STATUSLENGTH;
+            reply.u8(buff[(uint8_t)(indexId+1)]);
+            switch(buff[(uint8_t)(indexId+1)]){
+                case CAPTURESTOP:
+                    captureStop(&capture);
+                    reply.u8(ACK);
+                    break;
+                case CAPTURESTART:
+                    captureStart(&capture);
+                    reply.u8(ACK);
+                    break;
+                case CAPTUREREAD:
+                    // Sin detenerla la respuesta se volvería a capturar y la lectura no terminaría nunca
+                    captureStop(&capture);
+                    // Se lee solo lo que entra en la respuesta, lo leído ya no vuelve al buffer
+                    chunkLength=(reply.space()>3) ? reply.space()-3 : 0;
+                    if(chunkLength>sizeof(chunk))
+                        chunkLength=sizeof(chunk);
+                    chunkLength=captureRead(&capture, chunk, chunkLength);
+                    reply.u16(capture.lost).u8(chunkLength).array(chunk, chunkLength);
+                    break;
+                default:
+                    return STATUSARGUMENT;
+            }
             break;
+#endif
+        default:
+            return STATUSUNKNOWN;
     }
-   cheksum=0;
-    for(uint8_t a=0 ;a < indiceAux ;a++)
-    {
-        cheksum ^= auxBuffTx[a];
-        datosCom->bufferTx[datosCom->indexWriteTx++]=auxBuffTx[a];
+    return STATUSOK;
+}
+
+uint32_t readU32(const uint8_t *buff, uint8_t index)
+{
+    _udat word;
+
+    for(uint8_t i=0; i<4; i++)
+        word.ui8[i]=buff[(uint8_t)(index+i)];
+    return word.ui32;
+}
+
+/**
+ * @brief Pasa cada byte que genera el compresor al FrameWriter
+ * 
+ */
+static void frameSink(void *context, uint8_t dato)
+{
+    ((FrameWriter *)context)->u8(dato);
+}
+
+bool sendPayload(_sDato *datosCom, uint8_t txClass, const uint8_t *payload, uint8_t length)
+{
+    FrameWriter frame=txQueueWriter(&datosCom->tx, txClass, datosCom->framing);
+
+    frame.u8(0x01).u8(0x00);
+    // Primero se calcula el tamaño, conviene solo si ahorra más que el ID y el paso que se agregan
+    if(datosCom->compress && ((lzCompress(payload, length, datosCom->compressStride, NULL, NULL)+2)<length)){
+        frame.u8(COMPRESSED).u8(datosCom->compressStride);
+        lzCompress(payload, length, datosCom->compressStride, frameSink, &frame);
+    }else{
+        frame.array(payload, length);
     }
-        datosCom->bufferTx[datosCom->indexWriteTx++]=cheksum;
+    return commitFrame(datosCom, txClass, frame);
+}
+
 
+bool commitFrame(_sDato *datosCom, uint8_t txClass, FrameWriter &frame)
+{
+    return txQueueCommit(&datosCom->tx, txClass, frame, miTimer.read_ms());
+}
+
+void onWifiInfo(_sDato *datosCom, uint8_t status, const uint8_t *response, uint8_t length)
+{
+    uint8_t payload[2+ATRESPONSELENGTH];
+
+    if(length>ATRESPONSELENGTH)
+        length=ATRESPONSELENGTH;
+    payload[0]=WIFIINFO;
+    payload[1]=status;
+    memcpy(&payload[2], response, length);
+    sendPayload(datosCom, TXINTERACTIVE, payload, length+2);
 }
 
 
@@ -352,44 +1013,99 @@ void hearbeatTask(uint32_t *generalTime)
 }
 
 
-void comunicationsTask(_sDato *datosCom, uint8_t source){
-    if(datosCom->indexReadRx!=datosCom->indexWriteRx ){
+void comunicationsTask(_sDato *datosCom, Wifi *wifi){
+    int16_t dato;
+    uint8_t byteTx;
+
+    if(datosCom->indexScan!=datosCom->indexWriteRx ){
             decodeProtocol(datosCom);
     }
 
-    if(datosCom->indexReadTx!=datosCom->indexWriteTx){
-        if(source){
-            if(pcCom.writeable()){
-                pcCom.putc(datosCom->bufferTx[datosCom->indexReadTx++]);
+    if(wifi==NULL){
+        if(pcCom.writeable()){
+            dato=txQueuePeek(&datosCom->tx, miTimer.read_ms());
+            if(dato>=0){
+#if CAPTUREENABLE
+                captureByte(&capture, CAPTUREPC, true, dato);
+#endif
+                pcCom.putc(dato);
+                txQueuePop(&datosCom->tx);
+            }
+        }
+    }
+    else{
+        // Una trama nueva pasa al ESP recién cuando su buffer está casi vacío, así una respuesta de control
+        // no queda esperando detrás de datos masivos que ya se habían pasado. Si el buffer del ESP está lleno
+        // el byte queda en el canal y la trama no se corta
+        if(txQueueInFrame(&datosCom->tx) || (wifi->txPending()<TXFORWARDLIMIT)){
+            dato=txQueuePeek(&datosCom->tx, miTimer.read_ms());
+            if(dato>=0){
+                byteTx=dato;
+                if(wifi->writeWifiData(&byteTx,1))
+                    txQueuePop(&datosCom->tx);
             }
         }
-        else{
-            myWifi.writeWifiData(&datosCom->bufferTx[datosCom->indexReadTx++],1);  
-        } 
     } 
 }
 
+int8_t selectWifi(void){
+    static uint8_t lastWifi=WIFIMODULES-1;
+    uint8_t index;
+
+    for(uint8_t i=1; i<=WIFIMODULES; i++){
+        index=(lastWifi+i)%WIFIMODULES;
+        if(wifiModules[index]->isWifiReady() && !wifiModules[index]->isTxCongested() && !txQueueCongested(&datosComWifi[index].tx, TXBULK)){
+            lastWifi=index;
+            return index;
+        }
+    }
+    return -1;
+}
+
 void aliveAutoTask(uint32_t *aliveAutoTime){
-    if(myWifi.isWifiReady()){
-        if((miTimer.read_ms()-*aliveAutoTime)>=ALIVEAUTOINTERVAL){
+    int8_t indexWifi;
+
+    if((miTimer.read_ms()-*aliveAutoTime)>=ALIVEAUTOINTERVAL){
+        indexWifi=selectWifi();
+        if(indexWifi>=0){
             *aliveAutoTime=miTimer.read_ms();
-            datosComWifi.bufferRx[datosComWifi.indexWriteRx+POSID]=GETALIVE;
-            datosComWifi.indexStart=datosComWifi.indexWriteRx;
-            decodeData(&datosComWifi);
+            FrameWriter alive=txQueueWriter(&datosComWifi[indexWifi].tx, TXBULK, datosComWifi[indexWifi].framing);
+            alive.u8(0x01).u8(0x00).u8(GETALIVE).u8(ACK);
+            commitFrame(&datosComWifi[indexWifi], TXBULK, alive);
+        }else{
+            *aliveAutoTime=0;
         }
-    }else{
-        *aliveAutoTime=0;
     }
 }
 
+#if CAPTUREENABLE
+void onWifiCapture(Wifi *wifi, bool tx, uint8_t dato)
+{
+    for(uint8_t i=0; i<WIFIMODULES; i++){
+        if(wifiModules[i]==wifi)
+            captureByte(&capture, CAPTUREWIFI0+i, tx, dato);
+    }
+}
+#endif
+
 /**********************************************************************************/
 /* Servicio de Interrupciones*/
 
 void onDataRx(void)
 {
+    uint8_t dato;
+
     while (pcCom.readable())
     {
-        datosComSerie.bufferRx[datosComSerie.indexWriteRx++]=pcCom.getc();
+        dato=pcCom.getc();
+#if CAPTUREENABLE
+        captureByte(&capture, CAPTUREPC, false, dato);
+#endif
+        // Con el buffer lleno se descarta el byte nuevo en lugar de pisar uno que todavía no se leyó
+        if((uint8_t)(datosComSerie.indexWriteRx+1)!=datosComSerie.indexReadRx)
+            datosComSerie.bufferRx[datosComSerie.indexWriteRx++]=dato;
+        else if(datosComSerie.rxOverruns<0xFFFF)
+            datosComSerie.rxOverruns++;
     }
 }
 /* FIN Servicio de Interrupciones*/
@@ -406,6 +1122,7 @@ void autoConnectWifi(){
         memcpy(&myWifiData.cipstart,dataCipstart, sizeof(myWifiData.cipstart) );
         memcpy(&myWifiData.cipmode,dataCipmode, sizeof(myWifiData.cipmode) );
         memcpy(&myWifiData.cipsend,dataCipsend, sizeof(myWifiData.cipsend) );
-        myWifi.configWifi(&myWifiData);
+        for(uint8_t i=0; i<WIFIMODULES; i++)
+            wifiModules[i]->configWifi(&myWifiData);
     #endif
 }
\ No newline at end of file
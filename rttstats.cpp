@@ -0,0 +1,54 @@
+/*=============================================================================
+ * Copyright (c) 2021, Alejandro Rougier <alejandro.rougier@uner.edu.ar>
+ *
+ * All rights reserved.
+ * License: Free
+ * Date: 2021/11/12
+ * Version: v1.0
+ *===========================================================================*/
+
+/*==================[ Inclusions ]============================================*/
+
+#include "rttstats.h"
+
+/*==================[ Functions ]============================================*/
+
+void rttStatsInit(_sRttStats *stats)
+{
+    memset(stats, 0, sizeof(_sRttStats));
+}
+
+void rttStatsAdd(_sRttStats *stats, uint32_t rtt)
+{
+    stats->samples[stats->head]=rtt;
+    stats->head=(stats->head+1) % RTTSAMPLES;
+    if(stats->count<RTTSAMPLES)
+        stats->count++;
+    if(stats->total<0xFFFF)
+        stats->total++;
+}
+
+void rttStatsCompute(const _sRttStats *stats, _sRttSummary *summary)
+{
+    uint32_t sorted[RTTSAMPLES], value;
+    uint64_t sum=0;
+    uint8_t rank, j;
+
+    memset(summary, 0, sizeof(_sRttSummary));
+    if(stats->count==0)
+        return;
+
+    // Con pocas muestras el ordenamiento por inserción alcanza y no necesita memoria extra
+    for(uint8_t i=0; i<stats->count; i++){
+        value=stats->samples[i];
+        sum+=value;
+        for(j=i; (j>0) && (sorted[j-1]>value); j--)
+            sorted[j]=sorted[j-1];
+        sorted[j]=value;
+    }
+    rank=(RTTPERCENTILE*stats->count+99)/100;
+    summary->min=sorted[0];
+    summary->max=sorted[stats->count-1];
+    summary->avg=sum/stats->count;
+    summary->percentile=sorted[(rank>0) ? rank-1 : 0];
+}
@@ -0,0 +1,71 @@
+/*=============================================================================
+ * Copyright (c) 2021, Alejandro Rougier <alejandro.rougier@uner.edu.ar>
+ *
+ * All rights reserved.
+ * License: Free
+ * Date: 2021/11/12
+ * Version: v1.0
+ *===========================================================================*/
+
+/*==================[ Inclusions ]============================================*/
+
+#ifndef RTTSTATS_H
+#define RTTSTATS_H
+
+#include "mbed.h"
+
+/*==================[ Macros ]============================================*/
+
+#define RTTSAMPLES      16      //!< Muestras de la ventana sobre la que se calculan las estadísticas
+#define RTTPERCENTILE   90      //!< Percentil que se informa además de mínimo, promedio y máximo
+
+/*==================[ Global Variables ]============================================*/
+
+/**
+ * @brief Últimas muestras de RTT de un canal
+ *
+ */
+typedef struct{
+    uint32_t samples[RTTSAMPLES];   //!< Muestras en us, buffer circular
+    uint8_t head;                   //!< Posición de la próxima muestra
+    uint8_t count;                  //!< Muestras válidas en la ventana
+    uint16_t total;                 //!< Muestras recibidas desde el inicio (satura en 0xFFFF)
+}_sRttStats;
+
+/**
+ * @brief Estadísticas de la ventana, todos los tiempos en us
+ *
+ */
+typedef struct{
+    uint32_t min;
+    uint32_t avg;
+    uint32_t max;
+    uint32_t percentile;            //!< Percentil RTTPERCENTILE por rango más cercano
+}_sRttSummary;
+
+/*==================[ Functions ]============================================*/
+
+/**
+ * @brief Vacía la ventana
+ *
+ * @param stats Estadísticas del canal
+ */
+void rttStatsInit(_sRttStats *stats);
+
+/**
+ * @brief Agrega una muestra, si la ventana está llena reemplaza a la más vieja
+ *
+ * @param stats Estadísticas del canal
+ * @param rtt   RTT en us
+ */
+void rttStatsAdd(_sRttStats *stats, uint32_t rtt);
+
+/**
+ * @brief Calcula mínimo, promedio, máximo y percentil de la ventana
+ *
+ * @param stats     Estadísticas del canal
+ * @param summary   Resultado, todo en 0 si no hay muestras
+ */
+void rttStatsCompute(const _sRttStats *stats, _sRttSummary *summary);
+
+#endif
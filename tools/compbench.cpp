@@ -0,0 +1,165 @@
+/*=============================================================================
+ * Copyright (c) 2021, Alejandro Rougier <alejandro.rougier@uner.edu.ar>
+ *
+ * All rights reserved.
+ * License: Free
+ * Date: 2021/11/12
+ * Version: v1.0
+ *===========================================================================*/
+
+/**
+ * @brief Benchmark en la PC del compresor de compress.cpp
+ * Parte el archivo grabado en payloads del tamaño indicado, los comprime y descomprime uno por uno
+ * como lo hace el equipo, verifica que vuelvan iguales e informa la relación de compresión y los
+ * ciclos por byte (TSC en x86, nanosegundos en otras arquitecturas).
+ * Sin archivo usa 4 canales sintéticos de 16 bits que varían lento, como los de un sensor (conviene -s 8).
+ *
+ * Compilar desde la raíz del repositorio:
+ *   g++ -O2 -I. -o compbench tools/compbench.cpp compress.cpp
+ * Uso:
+ *   ./compbench [-f tamañoPayload] [-s pasoDelta] [archivo]
+ */
+
+#include "compress.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define CYCLEUNIT   "ciclos"
+static inline uint64_t readCycles(void)
+{
+    return __rdtsc();
+}
+#else
+#define CYCLEUNIT   "ns"
+static inline uint64_t readCycles(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec*1000000000ULL+now.tv_nsec;
+}
+#endif
+
+#define SYNTHETICLENGTH     (64*1024)
+#define REPETITIONS         20
+#define SYNTHETICCHANNELS   4
+
+typedef struct{
+    uint8_t *buff;
+    uint16_t length;
+}_sOut;
+
+static void bufferSink(void *context, uint8_t dato)
+{
+    _sOut *out=(_sOut *)context;
+
+    out->buff[out->length++]=dato;
+}
+
+static std::vector<uint8_t> syntheticData(void)
+{
+    std::vector<uint8_t> data;
+    int16_t sample[SYNTHETICCHANNELS]={0};
+
+    // Canales de 16 bits intercalados que cambian de a poco, la mayoría de las muestras repite el valor
+    srand(1);
+    for(uint32_t i=0; i<SYNTHETICLENGTH/(2*SYNTHETICCHANNELS); i++){
+        for(uint8_t c=0; c<SYNTHETICCHANNELS; c++){
+            if((rand()%4)==0)
+                sample[c]+=(rand()%3)-1;
+            data.push_back(sample[c] & 0xFF);
+            data.push_back(sample[c] >> 8);
+        }
+    }
+    return data;
+}
+
+int main(int argc, char **argv)
+{
+    uint8_t frameLength=64, stride=8;
+    const char *fileName=NULL;
+    std::vector<uint8_t> data;
+    uint8_t compressed[300], uncompressed[256];
+    uint64_t inBytes=0, outBytes=0, compressCycles=0, decompressCycles=0, start;
+    uint32_t frames=0;
+    _sOut out;
+    int opt;
+
+    while((opt=getopt(argc, argv, "f:s:"))!=-1){
+        switch(opt){
+            case 'f':
+                frameLength=atoi(optarg);
+                break;
+            case 's':
+                stride=atoi(optarg);
+                break;
+            default:
+                fprintf(stderr, "uso: %s [-f tamañoPayload] [-s pasoDelta] [archivo]\n", argv[0]);
+                return 1;
+        }
+    }
+    if(optind<argc)
+        fileName=argv[optind];
+    if((frameLength==0) || (frameLength>250)){
+        fprintf(stderr, "el payload tiene que ser de 1 a 250 bytes\n");
+        return 1;
+    }
+
+    if(fileName!=NULL){
+        FILE *file=fopen(fileName, "rb");
+        int dato;
+
+        if(file==NULL){
+            perror(fileName);
+            return 1;
+        }
+        while((dato=fgetc(file))!=EOF)
+            data.push_back(dato);
+        fclose(file);
+    }else{
+        data=syntheticData();
+    }
+
+    for(size_t offset=0; (offset+frameLength)<=data.size(); offset+=frameLength){
+        const uint8_t *payload=&data[offset];
+
+        out.buff=compressed;
+        for(uint8_t r=0; r<REPETITIONS; r++){
+            out.length=0;
+            start=readCycles();
+            lzCompress(payload, frameLength, stride, bufferSink, &out);
+            compressCycles+=readCycles()-start;
+        }
+        for(uint8_t r=0; r<REPETITIONS; r++){
+            start=readCycles();
+            lzDecompress(compressed, 0xFF, 0, out.length, stride, uncompressed, sizeof(uncompressed));
+            decompressCycles+=readCycles()-start;
+        }
+        if((lzDecompress(compressed, 0xFF, 0, out.length, stride, uncompressed, sizeof(uncompressed))!=frameLength) ||
+            memcmp(uncompressed, payload, frameLength)){
+            fprintf(stderr, "error: el payload %u no se recupera igual\n", frames);
+            return 1;
+        }
+        // En el enlace viaja sin comprimir si no conviene, con el ID COMPRESSED y el paso si conviene
+        outBytes+=((out.length+2)<frameLength) ? out.length+2 : frameLength;
+        inBytes+=frameLength;
+        frames++;
+    }
+    if(frames==0){
+        fprintf(stderr, "no hay datos suficientes para un payload\n");
+        return 1;
+    }
+
+    printf("payloads:         %u de %u bytes, delta %u\n", frames, frameLength, stride);
+    printf("bytes:            %llu -> %llu\n", (unsigned long long)inBytes, (unsigned long long)outBytes);
+    printf("relacion:         %.3f (%.1f%% ahorrado)\n", (double)inBytes/outBytes, 100.0*(1.0-(double)outBytes/inBytes));
+    printf("compresion:       %.1f %s/byte\n", (double)compressCycles/(inBytes*REPETITIONS), CYCLEUNIT);
+    printf("descompresion:    %.1f %s/byte\n", (double)decompressCycles/(inBytes*REPETITIONS), CYCLEUNIT);
+    return 0;
+}
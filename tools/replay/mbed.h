@@ -0,0 +1,170 @@
+/*=============================================================================
+ * Copyright (c) 2021, Alejandro Rougier <alejandro.rougier@uner.edu.ar>
+ *
+ * All rights reserved.
+ * License: Free
+ * Date: 2021/11/12
+ * Version: v1.0
+ *===========================================================================*/
+
+/*
+ * Reemplazo de mbed.h para compilar el firmware en la PC y correrlo con tools/replay/replay.cpp.
+ * Solo tiene lo que usa el firmware: los puertos serie leen y escriben en el motor de replay y el
+ * tiempo es un reloj virtual que avanza con cada lectura de un Timer, así cada corrida es determinística.
+ */
+
+#ifndef MBED_H
+#define MBED_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <functional>
+#include <deque>
+
+typedef enum{
+    PA_0, PA_1, PA_2, PA_3, PA_4, PA_9, PA_10,
+    PB_1, PB_6, PB_7, PB_10, PB_11, PB_13, PB_14,
+    PC_13,
+    NC
+}PinName;
+
+/*==================[ Callback ]============================================*/
+
+template<typename F> class Callback;
+
+template<typename R, typename... A>
+class Callback<R(A...)>{
+    public:
+        Callback(){}
+        Callback(R (*func)(A...)){
+            if(func)
+                function=func;
+        }
+        template<typename T>
+        Callback(T *obj, R (T::*method)(A...)){
+            function=[obj, method](A... args){ return (obj->*method)(args...); };
+        }
+        template<typename T, typename U>
+        Callback(R (*func)(T*, A...), U *arg){
+            function=[func, arg](A... args){ return func(arg, args...); };
+        }
+        R operator()(A... args) const { return function(args...); }
+        R call(A... args) const { return function(args...); }
+        explicit operator bool() const { return (bool)function; }
+    private:
+        std::function<R(A...)> function;
+};
+
+template<typename R, typename... A>
+Callback<R(A...)> callback(R (*func)(A...)){ return Callback<R(A...)>(func); }
+
+template<typename T, typename R, typename... A>
+Callback<R(A...)> callback(T *obj, R (T::*method)(A...)){ return Callback<R(A...)>(obj, method); }
+
+template<typename T, typename U, typename R, typename... A>
+Callback<R(A...)> callback(R (*func)(T*, A...), U *arg){ return Callback<R(A...)>(func, arg); }
+
+/*==================[ Motor de replay ]============================================*/
+
+class RawSerial;
+
+uint64_t replayNow();                               //!< Tiempo virtual en us sin avanzar el reloj
+uint64_t replayTick();                              //!< Avanza el reloj virtual, entrega lo que corresponda y devuelve el tiempo
+void replayRegister(RawSerial *serial, PinName tx); //!< Asocia un puerto serie del firmware a un puerto de la captura
+void replayPutc(RawSerial *serial, uint8_t dato);   //!< Byte transmitido por el firmware
+void replayCriticalExit();                          //!< Fin de una sección crítica, entrega lo pendiente
+
+/*==================[ Periféricos ]============================================*/
+
+class DigitalOut{
+    public:
+        DigitalOut(PinName pin, int value=0):state(value){ (void)pin; }
+        void write(int value){ state=value; }
+        int read(){ return state; }
+        DigitalOut &operator=(int value){ state=value; return *this; }
+        operator int(){ return state; }
+    private:
+        int state;
+};
+
+class SerialBase{
+    public:
+        enum IrqType{ RxIrq, TxIrq };
+        enum Flow{ Disabled, RTS, CTS, RTSCTS };
+        void set_flow_control(Flow type, PinName flow1=NC, PinName flow2=NC){ (void)type; (void)flow1; (void)flow2; }
+};
+
+class RawSerial : public SerialBase{
+    public:
+        RawSerial(PinName tx, PinName rx, int baud=9600):baudRate(baud),txBusyUntil(0){ (void)rx; replayRegister(this, tx); }
+        int getc(){
+            int dato=rx.front();
+            rx.pop_front();
+            return dato;
+        }
+        int putc(int dato){
+            // La USART tarda un caracter (10 bits) en liberar el registro de transmisión
+            txBusyUntil=replayNow()+10000000ULL/baudRate;
+            replayPutc(this, dato);
+            return dato;
+        }
+        int readable(){ return !rx.empty(); }
+        int writeable(){ return replayNow()>=txBusyUntil; }
+        void attach(Callback<void()> func, IrqType type=RxIrq){
+            if(type==RxIrq)
+                rxIrq=func;
+        }
+        void baud(int baud){ baudRate=baud; }
+
+        std::deque<uint8_t> rx;     //!< Bytes recibidos que el firmware todavía no leyó
+        Callback<void()> rxIrq;     //!< Interrupción de recepción
+        int baudRate;
+        uint64_t txBusyUntil;       //!< Momento en que se libera el registro de transmisión
+};
+
+class Timer{
+    public:
+        Timer():running(false), startTime(0), accumulated(0){}
+        void start(){
+            if(!running){
+                startTime=replayNow();
+                running=true;
+            }
+        }
+        void stop(){
+            accumulated=elapsed();
+            running=false;
+        }
+        void reset(){
+            accumulated=0;
+            startTime=replayNow();
+        }
+        int read_us(){ replayTick(); return (int)elapsed(); }
+        int read_ms(){ replayTick(); return (int)(elapsed()/1000); }
+        float read(){ replayTick(); return elapsed()/1000000.0f; }
+    private:
+        uint64_t elapsed(){ return accumulated+(running ? replayNow()-startTime : 0); }
+        bool running;
+        uint64_t startTime, accumulated;
+};
+
+/*==================[ Utilidades ]============================================*/
+
+extern int replayCriticalNesting;
+
+inline void core_util_critical_section_enter(){ replayCriticalNesting++; }
+inline void core_util_critical_section_exit(){ if(--replayCriticalNesting==0) replayCriticalExit(); }
+
+inline bool core_util_atomic_cas_u32(volatile uint32_t *ptr, uint32_t *expected, uint32_t desired){
+    if(*ptr==*expected){
+        *ptr=desired;
+        return true;
+    }
+    *expected=*ptr;
+    return false;
+}
+inline uint32_t core_util_atomic_incr_u32(volatile uint32_t *ptr, uint32_t delta){ return *ptr+=delta; }
+inline uint32_t core_util_atomic_decr_u32(volatile uint32_t *ptr, uint32_t delta){ return *ptr-=delta; }
+
+#endif
@@ -0,0 +1,628 @@
+/*=============================================================================
+ * Copyright (c) 2021, Alejandro Rougier <alejandro.rougier@uner.edu.ar>
+ *
+ * All rights reserved.
+ * License: Free
+ * Date: 2021/11/12
+ * Version: v1.0
+ *===========================================================================*/
+
+/**
+ * @brief Reproduce una captura del comando CAPTURE sobre el firmware compilado para la PC
+ * El firmware (main.cpp, wifi.cpp, ...) se compila con el mbed.h de este directorio: los bytes recibidos de la
+ * captura se entregan a la interrupción de recepción del puerto que corresponde en el momento en que llegaron
+ * (dividido por el factor de compresión -x) y lo que transmite el firmware se registra y se compara con lo que
+ * se transmitió en la captura. El tiempo es virtual, avanza -t us en cada lectura de un Timer y los puertos
+ * tardan lo mismo que la USART real en transmitir cada byte, así dos corridas sobre la misma captura hacen
+ * exactamente lo mismo y las diferencias de rendimiento se ven en el tiempo real (wall) que tardan.
+ * La latencia de respuesta es el tiempo entre el último byte recibido y el primer byte transmitido después,
+ * se calcula igual sobre la captura original, sobre el tiempo virtual y sobre el tiempo real de la corrida.
+ * La corrida termina cuando se entregó toda la captura y pasaron -d ms virtuales.
+ *
+ * El archivo de captura son los registros de las respuestas de CAPTURE lectura, concatenados en orden.
+ * El equipo tiene que estar compilado con CAPTUREENABLE en config.h, y con CAPTUREATBOOT para reproducir desde el arranque.
+ *
+ * Con -e, en lugar de (o además de) una captura, un guion hace de módulo: cada línea es un paso que se ejecuta
+ * en orden cuando se cumple el anterior.
+ *   port <PC|WIFI0|WIFI1>  puerto de los pasos que siguen (WIFI0 al comenzar)
+ *   timeout <ms>           espera máxima de expect y next (SCRIPTTIMEOUTMS al comenzar)
+ *   expect <texto>         espera a que el firmware transmita el texto, saltando lo que haya antes
+ *   next <texto>           lo próximo que transmite el firmware tiene que ser el texto
+ *   send <texto>           el puerto recibe el texto a la velocidad de la USART
+ *   wait <ms>              deja pasar el tiempo
+ * El texto admite \r, \n, \t, \\ y \xNN; las líneas vacías y las que empiezan con # se ignoran. Si un paso no
+ * se cumple la corrida termina con código 1 mostrando lo que se transmitió, así un guion sirve de prueba.
+ *
+ * Compilar desde la raíz del repositorio:
+ *   g++ -O2 -std=gnu++14 -funsigned-char -Itools/replay -I. -Dmain=firmwareMain -o replay tools/replay/replay.cpp \
+ *       main.cpp wifi.cpp cobs.cpp framewriter.cpp apscan.cpp txqueue.cpp compress.cpp framepool.cpp rttstats.cpp capture.cpp
+ * Uso:
+ *   ./replay [-x factor] [-t us por lectura del Timer] [-d ms de drenaje] [-v] [-e guion] [captura.bin]
+ *   ./replay -l captura.bin       lista los registros agrupados por puerto y sentido
+ */
+
+#include "mbed.h"
+#include "config.h"
+#include "capture.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <chrono>
+#include <deque>
+#include <vector>
+#include <algorithm>
+
+#undef main
+
+#define CAPTUREPORTS        3
+#define DEFAULTSTEPUS       1           //!< us virtuales que avanza cada lectura de un Timer
+#define DEFAULTDRAINMS      500         //!< Tiempo que sigue corriendo el firmware después del último registro
+#define LATENCYPERCENTILE   90
+#define SCRIPTTIMEOUTMS     20000       //!< Espera máxima de expect y next si el guion no indica otra
+#define SCRIPTLINELENGTH    512
+
+typedef std::chrono::steady_clock _clock;
+
+/**
+ * @brief Un byte de la captura
+ *
+ */
+typedef struct{
+    uint64_t time;      //!< us desde el comienzo de la captura
+    uint8_t port;
+    bool tx;
+    uint8_t dato;
+}_sRecord;
+
+/**
+ * @brief Tiempo de respuesta, tx-rx, para cada respuesta
+ *
+ */
+typedef struct{
+    bool waiting;                   //!< Se recibió algo y todavía no se transmitió nada
+    uint64_t lastRx;
+    std::vector<uint64_t> samples;
+}_sLatency;
+
+/**
+ * @brief Lo que pasó por un puerto durante la corrida
+ *
+ */
+typedef struct{
+    uint32_t rxInjected;
+    uint32_t rxSkipped;             //!< Bytes de la captura para un puerto que no existe
+    std::vector<uint8_t> txCaptured;
+    std::vector<uint8_t> tx;
+}_sPort;
+
+/**
+ * @brief Pasos del guion
+ *
+ */
+typedef enum{
+    SCRIPTEXPECT,
+    SCRIPTNEXT,
+    SCRIPTSEND,
+    SCRIPTWAIT
+}_eScriptOp;
+
+/**
+ * @brief Un paso del guion
+ *
+ */
+typedef struct{
+    uint8_t op;                     //!< _eScriptOp
+    uint8_t port;
+    unsigned line;                  //!< Línea del archivo, para los mensajes
+    std::vector<uint8_t> text;
+    uint64_t time;                  //!< us de espera (wait) o espera máxima (expect, next)
+}_sScriptStep;
+
+int replayCriticalNesting=0;
+
+static const char *portNames[CAPTUREPORTS]={"PC", "WIFI0", "WIFI1"};
+
+static std::vector<_sRecord> records;
+static std::vector<size_t> rxRecords;   //!< Indices de los registros RX, en orden
+static size_t nextRx;
+static _sPort ports[CAPTUREPORTS];
+// Los puertos del firmware se registran durante la inicialización estática, por eso van aparte en un arreglo sin constructor
+static RawSerial *serials[CAPTUREPORTS];    //!< NULL si el firmware no tiene el puerto (WIFIMODULES)
+static uint64_t now, step=DEFAULTSTEPUS, drain=DEFAULTDRAINMS*1000ULL, endTime;
+static double factor=1.0;
+static bool delivering, verbose;
+static _sLatency latencyVirtual, latencyWall;
+static _clock::time_point wallStart;
+
+static const char *scriptPath;
+static std::vector<_sScriptStep> script;
+static size_t scriptStep;
+static uint64_t scriptStepStart, scriptRxTime;
+static size_t scriptMatch[CAPTUREPORTS];    //!< Posición de lo transmitido desde donde se busca el próximo texto
+static size_t scriptSeen=SIZE_MAX;          //!< Bytes transmitidos cuando se buscó por última vez
+static std::deque<_sRecord> scriptRx;       //!< Bytes de los send pendientes de entregar
+
+/**
+ * @brief Lee la captura, devuelve false si el archivo está truncado o no se puede abrir
+ *
+ */
+static bool loadCapture(const char *path)
+{
+    FILE *file=fopen(path, "rb");
+    std::vector<uint8_t> raw;
+    uint8_t buff[4096], tag;
+    size_t length, i=0;
+    uint64_t ticks=0;
+    uint32_t delta;
+    bool truncated=false;
+    _sRecord record;
+
+    if(file==NULL){
+        perror(path);
+        return false;
+    }
+    while((length=fread(buff, 1, sizeof(buff), file))>0)
+        raw.insert(raw.end(), buff, buff+length);
+    fclose(file);
+
+    while(i<raw.size()){
+        tag=raw[i++];
+        delta=tag & CAPTUREDELTABITS;
+        if(delta==CAPTUREDELTAEXT){
+            if((i+2)>raw.size()){
+                truncated=true;
+                break;
+            }
+            delta=raw[i] | (raw[i+1]<<8);
+            i+=2;
+        }
+        if(i>=raw.size()){
+            truncated=true;
+            break;
+        }
+        // Un registro de pausa solo suma tiempo, el byte es la cantidad de veces CAPTUREGAP ticks
+        if(delta==CAPTUREGAP){
+            ticks+=(uint64_t)raw[i++]*CAPTUREGAP;
+            continue;
+        }
+        ticks+=delta;
+        record.time=ticks<<CAPTURETICKSHIFT;
+        record.port=tag>>CAPTUREPORTSHIFT;
+        record.tx=(tag & CAPTURETX)!=0;
+        record.dato=raw[i++];
+        if(record.port>=CAPTUREPORTS){
+            fprintf(stderr, "%s: puerto %u inválido en el byte %zu\n", path, record.port, i);
+            return false;
+        }
+        records.push_back(record);
+    }
+    if(truncated){
+        fprintf(stderr, "%s: registro truncado al final\n", path);
+        return false;
+    }
+    return true;
+}
+
+static void listCapture()
+{
+    size_t i=0, j;
+
+    // Agrupa los bytes consecutivos del mismo puerto y sentido en una línea
+    while(i<records.size()){
+        printf("%10.3f ms  %-5s %s ", records[i].time/1000.0, portNames[records[i].port], records[i].tx ? "TX" : "RX");
+        for(j=i; (j<records.size()) && (records[j].port==records[i].port) && (records[j].tx==records[i].tx) && ((j-i)<24); j++)
+            printf(" %02X", records[j].dato);
+        printf("%*s  ", (int)(24-(j-i))*3, "");
+        for(size_t k=i; k<j; k++)
+            putchar(((records[k].dato>=0x20) && (records[k].dato<0x7F)) ? records[k].dato : '.');
+        putchar('\n');
+        i=j;
+    }
+}
+
+static uint64_t wallNs()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(_clock::now()-wallStart).count();
+}
+
+static void latencyRx(_sLatency *latency, uint64_t time)
+{
+    latency->waiting=true;
+    latency->lastRx=time;
+}
+
+static void latencyTx(_sLatency *latency, uint64_t time)
+{
+    if(latency->waiting){
+        latency->samples.push_back(time-latency->lastRx);
+        latency->waiting=false;
+    }
+}
+
+static void printLatency(const char *name, std::vector<uint64_t> samples, double scale, const char *unit)
+{
+    uint64_t sum=0;
+    size_t rank;
+
+    if(samples.empty()){
+        printf("  %-16s sin respuestas\n", name);
+        return;
+    }
+    std::sort(samples.begin(), samples.end());
+    for(uint64_t sample : samples)
+        sum+=sample;
+    rank=(LATENCYPERCENTILE*samples.size()+99)/100;
+    printf("  %-16s n=%-6zu min %9.1f  avg %9.1f  p%d %9.1f  max %9.1f %s\n", name, samples.size(),
+           samples.front()*scale, (double)sum/samples.size()*scale, LATENCYPERCENTILE,
+           samples[rank-1]*scale, samples.back()*scale, unit);
+}
+
+static void report()
+{
+    uint64_t wall=wallNs();
+    uint32_t rxTotal=0, txTotal=0;
+    size_t same, first, compared;
+    _sLatency latencyCapture={};
+
+    for(const _sRecord &record : records){
+        if(record.tx)
+            latencyTx(&latencyCapture, record.time);
+        else
+            latencyRx(&latencyCapture, record.time);
+    }
+
+    if(!script.empty())
+        printf("guion: %zu/%zu pasos cumplidos\n", scriptStep, script.size());
+    printf("captura: %zu registros, %.3f s, factor de tiempo %.2f\n", records.size(),
+           records.empty() ? 0.0 : records.back().time/1e6, factor);
+    printf("corrida: %.3f s virtuales, %.3f s reales (%.1fx)\n", now/1e6, wall/1e9, wall ? now*1000.0/wall : 0.0);
+    for(uint8_t i=0; i<CAPTUREPORTS; i++){
+        if(ports[i].rxInjected || ports[i].rxSkipped || ports[i].txCaptured.size() || ports[i].tx.size())
+            printf("  %-5s RX %u entregados, %u sin puerto  TX %zu (captura %zu)\n", portNames[i], ports[i].rxInjected,
+                   ports[i].rxSkipped, ports[i].tx.size(), ports[i].txCaptured.size());
+        rxTotal+=ports[i].rxInjected;
+        txTotal+=ports[i].tx.size();
+    }
+    printf("throughput: %.0f bytes/s virtuales, %.1f ns reales por byte\n",
+           now ? (rxTotal+txTotal)*1e6/now : 0.0, (rxTotal+txTotal) ? (double)wall/(rxTotal+txTotal) : 0.0);
+
+    printf("latencia de respuesta:\n");
+    printLatency("captura", latencyCapture.samples, 1.0, "us");
+    printLatency("replay virtual", latencyVirtual.samples, 1.0, "us");
+    printLatency("replay real", latencyWall.samples, 1.0, "ns");
+
+    // Lo transmitido tiene que coincidir con la captura salvo los datos que dependen del tiempo (PING, ALIVE...)
+    printf("TX contra la captura:\n");
+    for(uint8_t i=0; i<CAPTUREPORTS; i++){
+        if(ports[i].txCaptured.empty() && ports[i].tx.empty())
+            continue;
+        compared=std::min(ports[i].txCaptured.size(), ports[i].tx.size());
+        same=0;
+        first=compared;
+        for(size_t k=0; k<compared; k++){
+            if(ports[i].txCaptured[k]==ports[i].tx[k])
+                same++;
+            else if(first==compared)
+                first=k;
+        }
+        printf("  %-5s %zu/%zu bytes iguales", portNames[i], same, std::max(ports[i].txCaptured.size(), ports[i].tx.size()));
+        if(first<compared)
+            printf(", primera diferencia en el byte %zu", first);
+        putchar('\n');
+    }
+}
+
+/**
+ * @brief Convierte las secuencias de escape del texto de un paso
+ *
+ */
+static bool scriptText(const char *text, std::vector<uint8_t> *out)
+{
+    unsigned value;
+
+    for(; *text!='\0'; text++){
+        if(*text!='\\'){
+            out->push_back(*text);
+            continue;
+        }
+        switch(*++text){
+            case 'r': out->push_back('\r'); break;
+            case 'n': out->push_back('\n'); break;
+            case 't': out->push_back('\t'); break;
+            case '\\': out->push_back('\\'); break;
+            case 'x':
+                if(sscanf(text+1, "%2x", &value)!=1)
+                    return false;
+                out->push_back(value);
+                text+=2;
+                break;
+            default:
+                return false;
+        }
+    }
+    return true;
+}
+
+static bool loadScript(const char *path)
+{
+    FILE *file=fopen(path, "r");
+    char line[SCRIPTLINELENGTH], *command, *argument;
+    unsigned number=0;
+    uint8_t port=CAPTUREWIFI0;
+    uint64_t timeout=SCRIPTTIMEOUTMS*1000ULL;
+    _sScriptStep step;
+
+    if(file==NULL){
+        perror(path);
+        return false;
+    }
+    while(fgets(line, sizeof(line), file)!=NULL){
+        number++;
+        line[strcspn(line, "\r\n")]='\0';
+        if((line[0]=='\0') || (line[0]=='#'))
+            continue;
+        command=line;
+        argument=strchr(line, ' ');
+        if(argument!=NULL)
+            *argument++='\0';
+        else
+            argument=line+strlen(line);
+        step.port=port;
+        step.line=number;
+        step.text.clear();
+        step.time=timeout;
+        if(!strcmp(command, "port")){
+            for(port=0; (port<CAPTUREPORTS) && strcmp(argument, portNames[port]); port++);
+            if(port<CAPTUREPORTS)
+                continue;
+        }else if(!strcmp(command, "timeout")){
+            timeout=strtoull(argument, NULL, 10)*1000ULL;
+            continue;
+        }else if(!strcmp(command, "wait")){
+            step.op=SCRIPTWAIT;
+            step.time=strtoull(argument, NULL, 10)*1000ULL;
+            script.push_back(step);
+            continue;
+        }else if(!strcmp(command, "expect") || !strcmp(command, "next") || !strcmp(command, "send")){
+            step.op=!strcmp(command, "expect") ? SCRIPTEXPECT : (!strcmp(command, "next") ? SCRIPTNEXT : SCRIPTSEND);
+            if(scriptText(argument, &step.text) && !step.text.empty()){
+                script.push_back(step);
+                continue;
+            }
+        }
+        fprintf(stderr, "%s:%u: paso inválido\n", path, number);
+        fclose(file);
+        return false;
+    }
+    fclose(file);
+    return true;
+}
+
+static void report();
+
+/**
+ * @brief Termina la corrida con error mostrando lo que transmitió el firmware desde el último paso cumplido
+ *
+ */
+static void scriptFail(const _sScriptStep *step, const char *reason)
+{
+    const std::vector<uint8_t> &tx=ports[step->port].tx;
+
+    printf("%s:%u: %s en %s a los %.3f ms\n  transmitido: \"", scriptPath, step->line, reason, portNames[step->port], now/1000.0);
+    for(size_t i=scriptMatch[step->port]; (i<tx.size()) && (i<(scriptMatch[step->port]+120)); i++){
+        if((tx[i]>=0x20) && (tx[i]<0x7F) && (tx[i]!='\\'))
+            putchar(tx[i]);
+        else
+            printf("\\x%02X", tx[i]);
+    }
+    printf("\"\n");
+    report();
+    fflush(stdout);
+    _exit(1);
+}
+
+/**
+ * @brief Avanza el guion todo lo que se pueda con lo transmitido hasta ahora
+ *
+ */
+static void runScript()
+{
+    const _sScriptStep *step;
+    std::vector<uint8_t>::const_iterator found;
+    uint64_t time, byteTime;
+
+    while(scriptStep<script.size()){
+        step=&script[scriptStep];
+        const std::vector<uint8_t> &tx=ports[step->port].tx;
+        switch(step->op){
+            case SCRIPTEXPECT:
+            case SCRIPTNEXT:
+                // Solo se vuelve a buscar si el firmware transmitió algo, salvo para controlar la espera máxima
+                if(tx.size()!=scriptSeen){
+                    scriptSeen=tx.size();
+                    if(step->op==SCRIPTEXPECT)
+                        found=std::search(tx.begin()+scriptMatch[step->port], tx.end(), step->text.begin(), step->text.end());
+                    else if(!std::equal(tx.begin()+scriptMatch[step->port],
+                                        tx.begin()+std::min(tx.size(), scriptMatch[step->port]+step->text.size()), step->text.begin()))
+                        scriptFail(step, "se transmitió otra cosa");
+                    else if((tx.size()-scriptMatch[step->port])<step->text.size())
+                        found=tx.end();
+                    else
+                        found=tx.begin()+scriptMatch[step->port];
+                    if(found!=tx.end()){
+                        scriptMatch[step->port]=(found-tx.begin())+step->text.size();
+                        break;
+                    }
+                }
+                if((now-scriptStepStart)>=step->time)
+                    scriptFail(step, "no se transmitió el texto esperado");
+                return;
+            case SCRIPTSEND:
+                byteTime=10000000ULL/((serials[step->port]!=NULL) ? serials[step->port]->baudRate : 115200);
+                time=std::max(now, scriptRxTime);
+                for(uint8_t dato : step->text){
+                    scriptRx.push_back({time, step->port, false, dato});
+                    time+=byteTime;
+                }
+                scriptRxTime=time;
+                break;
+            case SCRIPTWAIT:
+                if((now-scriptStepStart)<step->time)
+                    return;
+                break;
+        }
+        scriptStep++;
+        scriptStepStart=now;
+        scriptSeen=SIZE_MAX;
+        if(scriptStep==script.size())
+            endTime=std::max(endTime, scriptRxTime+drain);
+    }
+}
+
+/**
+ * @brief Entrega un byte recibido a la interrupción de su puerto
+ *
+ */
+static void inject(uint8_t port, uint8_t dato)
+{
+    RawSerial *serial=serials[port];
+
+    if(serial==NULL){
+        ports[port].rxSkipped++;
+        return;
+    }
+    ports[port].rxInjected++;
+    latencyRx(&latencyVirtual, now);
+    latencyRx(&latencyWall, wallNs());
+    if(verbose)
+        printf("%10.3f ms  %-5s RX %02X\n", now/1000.0, portNames[port], dato);
+    serial->rx.push_back(dato);
+    if(serial->rxIrq)
+        serial->rxIrq();
+}
+
+/**
+ * @brief Entrega los bytes recibidos cuyo momento ya pasó
+ * No entra dentro de una sección crítica ni desde la propia interrupción, igual que el NVIC
+ */
+static void deliver()
+{
+    const _sRecord *record;
+
+    if(delivering || replayCriticalNesting)
+        return;
+    delivering=true;
+    runScript();
+    while((nextRx<rxRecords.size()) && ((uint64_t)(records[rxRecords[nextRx]].time/factor)<=now)){
+        record=&records[rxRecords[nextRx++]];
+        inject(record->port, record->dato);
+    }
+    while(!scriptRx.empty() && (scriptRx.front().time<=now)){
+        inject(scriptRx.front().port, scriptRx.front().dato);
+        scriptRx.pop_front();
+    }
+    delivering=false;
+}
+
+uint64_t replayNow()
+{
+    return now;
+}
+
+uint64_t replayTick()
+{
+    now+=step;
+    deliver();
+    if((nextRx>=rxRecords.size()) && (scriptStep>=script.size()) && scriptRx.empty() && (now>=endTime) && !replayCriticalNesting){
+        report();
+        fflush(stdout);
+        _exit(0);
+    }
+    return now;
+}
+
+void replayRegister(RawSerial *serial, PinName tx)
+{
+    if(tx==PA_9)
+        serials[CAPTUREPC]=serial;
+    else if(tx==WIFITX0)
+        serials[CAPTUREWIFI0]=serial;
+    else if(tx==WIFITX1)
+        serials[CAPTUREWIFI1]=serial;
+}
+
+void replayPutc(RawSerial *serial, uint8_t dato)
+{
+    for(uint8_t i=0; i<CAPTUREPORTS; i++){
+        if(serials[i]==serial){
+            ports[i].tx.push_back(dato);
+            if(verbose)
+                printf("%10.3f ms  %-5s TX %02X\n", now/1000.0, portNames[i], dato);
+        }
+    }
+    latencyTx(&latencyVirtual, now);
+    latencyTx(&latencyWall, wallNs());
+}
+
+void replayCriticalExit()
+{
+    deliver();
+}
+
+int firmwareMain();
+
+int main(int argc, char **argv)
+{
+    int opt;
+    bool list=false;
+
+    while((opt=getopt(argc, argv, "x:t:d:e:lv"))!=-1){
+        switch(opt){
+            case 'x':
+                factor=atof(optarg);
+                break;
+            case 't':
+                step=strtoull(optarg, NULL, 10);
+                break;
+            case 'd':
+                drain=strtoull(optarg, NULL, 10)*1000ULL;
+                break;
+            case 'e':
+                scriptPath=optarg;
+                break;
+            case 'l':
+                list=true;
+                break;
+            case 'v':
+                verbose=true;
+                break;
+            default:
+                optind=argc+1;
+                break;
+        }
+    }
+    if((optind<(argc-1)) || ((optind==argc) && ((scriptPath==NULL) || list)) || (factor<=0) || (step==0)){
+        fprintf(stderr, "uso: %s [-x factor] [-t us por lectura] [-d ms de drenaje] [-e guion] [-l] [-v] [captura.bin]\n", argv[0]);
+        return 1;
+    }
+    if((optind<argc) && !loadCapture(argv[optind]))
+        return 1;
+    if((scriptPath!=NULL) && !loadScript(scriptPath))
+        return 1;
+    if(list){
+        listCapture();
+        return 0;
+    }
+
+    for(size_t i=0; i<records.size(); i++){
+        if(records[i].tx)
+            ports[records[i].port].txCaptured.push_back(records[i].dato);
+        else
+            rxRecords.push_back(i);
+    }
+    endTime=(records.empty() ? 0 : (uint64_t)(records.back().time/factor))+drain;
+
+    wallStart=_clock::now();
+    firmwareMain();
+    return 0;
+}
@@ -0,0 +1,581 @@
+/*=============================================================================
+ * Copyright (c) 2021, Alejandro Rougier <alejandro.rougier@uner.edu.ar>
+ *
+ * All rights reserved.
+ * License: Free
+ * Date: 2021/11/12
+ * Version: v1.0
+ *===========================================================================*/
+
+/**
+ * @brief Colector UDP y generador de carga para Linux que hablan el protocolo UNER
+ * collect:  recibe las tramas de los equipos (AT+CIPSTART de config.h apunta al puerto 30010) con un hilo por
+ *           núcleo. Cada hilo tiene su socket con SO_REUSEPORT, su epoll y lee de a lotes con recvmmsg; el kernel
+ *           reparte por dirección de origen, así cada equipo queda siempre en el mismo hilo y no hace falta
+ *           sincronizar los decodificadores. Informa tramas/s por hilo y, al terminar, las estadísticas de cada equipo.
+ * generate: simula N equipos, cada uno con su socket, que envían GETALIVE y telemetría a la tasa indicada.
+ * bench:    corre colector y generador por loopback con 1, 2, 4... hilos e informa tramas/s, pérdida y escalado.
+ * La telemetría simulada usa el ID TELEMETRY con un número de secuencia para que el colector cuente las pérdidas;
+ * en las tramas de los equipos reales, que no lo llevan, solo se cuentan tramas y errores de cheksum.
+ * Las tramas pueden llegar partidas en varios datagramas (el ESP arma los paquetes a su criterio), el decodificador
+ * de cada equipo es incremental igual que decodeProtocol() en main.cpp.
+ *
+ * Compilar desde la raíz del repositorio:
+ *   g++ -O2 -std=c++17 -pthread -o udpcollector tools/udpcollector.cpp
+ * Uso:
+ *   ./udpcollector collect  [-p puerto] [-t hilos] [-d segundos] [-v]
+ *   ./udpcollector generate [-a ip] [-p puerto] [-n equipos] [-r tramas/s por equipo, 0 sin límite] [-t hilos] [-d segundos]
+ *   ./udpcollector bench    [-p puerto] [-n equipos] [-r tramas/s por equipo] [-t hilos máximo] [-d segundos por paso]
+ */
+
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include <algorithm>
+
+#define DEFAULTPORT         30010
+#define BATCHLENGTH         64          //!< Datagramas por llamada a recvmmsg
+#define DATAGRAMLENGTH      1500
+#define RCVBUFLENGTH        (4*1024*1024)
+#define TELEMETRYSAMPLES    16          //!< Bytes de muestras en cada trama de telemetría simulada
+#define ALIVEEVERY          10          //!< Una de cada ALIVEEVERY tramas simuladas es GETALIVE
+
+#define GETALIVE            0xF0
+#define ACK                 0x0D
+#define TELEMETRY           0xA0        //!< Solo lo usa esta herramienta: secuencia u32 y muestras
+
+typedef std::chrono::steady_clock _clock;
+
+/*==================[ Decodificador UNER ]============================================*/
+
+/**
+ * @brief Decodificador incremental de tramas UNER, una instancia por equipo
+ *
+ */
+class UnerDecoder
+{
+    public:
+        /**
+         * @brief Procesa bytes recibidos y llama a onFrame(payload, longitud) por cada trama con cheksum correcto
+         * El payload empieza después de ':' (0x01, 0x00, ID, datos) y no incluye el cheksum.
+         */
+        template <typename F>
+        void feed(const uint8_t *data, size_t length, F onFrame){
+            for(size_t i=0; i<length; i++){
+                uint8_t dato=data[i];
+
+                switch(state){
+                    case START:
+                        if(dato=='U')
+                            state=HEADER_1;
+                        break;
+                    case HEADER_1:
+                        state=(dato=='N') ? HEADER_2 : ((dato=='U') ? HEADER_1 : START);
+                        break;
+                    case HEADER_2:
+                        state=(dato=='E') ? HEADER_3 : ((dato=='U') ? HEADER_1 : START);
+                        break;
+                    case HEADER_3:
+                        state=(dato=='R') ? NBYTES : ((dato=='U') ? HEADER_1 : START);
+                        break;
+                    case NBYTES:
+                        nBytes=dato;
+                        cheksum='U'^'N'^'E'^'R'^dato;
+                        state=(nBytes>0) ? TOKEN : START;
+                        break;
+                    case TOKEN:
+                        if(dato==':'){
+                            cheksum^=dato;
+                            payloadLength=0;
+                            state=PAYLOAD;
+                        }else{
+                            state=(dato=='U') ? HEADER_1 : START;
+                        }
+                        break;
+                    case PAYLOAD:
+                        if(payloadLength<(nBytes-1)){
+                            payload[payloadLength++]=dato;
+                            cheksum^=dato;
+                            break;
+                        }
+                        if(dato==cheksum)
+                            onFrame(payload, payloadLength);
+                        else
+                            badCheksum++;
+                        state=START;
+                        break;
+                }
+            }
+        }
+        uint64_t badCheksum=0;
+    private:
+        enum{START, HEADER_1, HEADER_2, HEADER_3, NBYTES, TOKEN, PAYLOAD} state=START;
+        uint8_t nBytes=0;
+        uint8_t cheksum=0;
+        uint16_t payloadLength=0;
+        uint8_t payload[256];
+};
+
+/**
+ * @brief Arma una trama UNER con el payload (0x01, 0x00, ID, datos)
+ *
+ */
+static size_t unerEncode(const uint8_t *payload, uint8_t length, uint8_t *frame)
+{
+    uint8_t cheksum=0;
+    size_t n=0;
+
+    frame[n++]='U';
+    frame[n++]='N';
+    frame[n++]='E';
+    frame[n++]='R';
+    frame[n++]=length+1;
+    frame[n++]=':';
+    memcpy(&frame[n], payload, length);
+    n+=length;
+    for(size_t i=0; i<n; i++)
+        cheksum^=frame[i];
+    frame[n++]=cheksum;
+    return n;
+}
+
+/*==================[ Colector ]============================================*/
+
+/**
+ * @brief Estadísticas de un equipo, identificado por IP y puerto de origen
+ *
+ */
+typedef struct{
+    UnerDecoder decoder;
+    uint64_t datagrams=0;
+    uint64_t bytes=0;
+    uint64_t frames=0;
+    uint64_t alive=0;
+    uint64_t telemetry=0;
+    uint64_t lost=0;            //!< Huecos en la secuencia de telemetría
+    uint64_t reordered=0;       //!< Telemetría con secuencia menor a la esperada
+    uint32_t nextSequence=0;
+    bool hasSequence=false;
+}_sDevice;
+
+/**
+ * @brief Estado de un hilo del colector
+ *
+ */
+typedef struct{
+    std::thread thread;
+    std::mutex lock;                                    //!< Protege devices mientras el hilo principal lo recorre
+    std::unordered_map<uint64_t, _sDevice> devices;
+    std::atomic<uint64_t> datagrams{0};
+    std::atomic<uint64_t> frames{0};
+    int fd=-1;
+}_sWorker;
+
+// Separados para que en bench el colector siga vaciando los sockets después de detener el generador
+static std::atomic<bool> collecting{true};
+static std::atomic<bool> generating{true};
+
+static void onFrame(_sDevice &device, const uint8_t *payload, uint16_t length)
+{
+    uint32_t sequence;
+
+    device.frames++;
+    if(length<3)
+        return;
+    if(payload[2]==GETALIVE){
+        device.alive++;
+    }else if((payload[2]==TELEMETRY) && (length>=7)){
+        device.telemetry++;
+        memcpy(&sequence, &payload[3], sizeof(sequence));
+        if(device.hasSequence && (sequence<device.nextSequence)){
+            device.reordered++;
+            return;
+        }
+        if(device.hasSequence)
+            device.lost+=sequence-device.nextSequence;
+        device.hasSequence=true;
+        device.nextSequence=sequence+1;
+    }
+}
+
+static int openCollectorSocket(uint16_t port)
+{
+    int fd=socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK, 0), one=1, rcvbuf=RCVBUFLENGTH;
+    struct sockaddr_in addr;
+
+    if(fd<0)
+        return -1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &one, sizeof(one));
+    setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family=AF_INET;
+    addr.sin_addr.s_addr=htonl(INADDR_ANY);
+    addr.sin_port=htons(port);
+    if(bind(fd, (struct sockaddr *)&addr, sizeof(addr))<0){
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+static void collectorWorker(_sWorker *worker)
+{
+    static thread_local uint8_t buffers[BATCHLENGTH][DATAGRAMLENGTH];
+    struct mmsghdr messages[BATCHLENGTH];
+    struct iovec iovecs[BATCHLENGTH];
+    struct sockaddr_in sources[BATCHLENGTH];
+    struct epoll_event event;
+    int epollFd=epoll_create1(0), received;
+    uint64_t frames;
+
+    event.events=EPOLLIN;
+    event.data.fd=worker->fd;
+    epoll_ctl(epollFd, EPOLL_CTL_ADD, worker->fd, &event);
+
+    while(collecting){
+        if(epoll_wait(epollFd, &event, 1, 100)<=0)
+            continue;
+        while(true){
+            for(int i=0; i<BATCHLENGTH; i++){
+                iovecs[i].iov_base=buffers[i];
+                iovecs[i].iov_len=DATAGRAMLENGTH;
+                memset(&messages[i].msg_hdr, 0, sizeof(messages[i].msg_hdr));
+                messages[i].msg_hdr.msg_iov=&iovecs[i];
+                messages[i].msg_hdr.msg_iovlen=1;
+                messages[i].msg_hdr.msg_name=&sources[i];
+                messages[i].msg_hdr.msg_namelen=sizeof(sources[i]);
+            }
+            received=recvmmsg(worker->fd, messages, BATCHLENGTH, MSG_DONTWAIT, NULL);
+            if(received<=0)
+                break;
+            frames=0;
+            {
+                std::lock_guard<std::mutex> guard(worker->lock);
+                for(int i=0; i<received; i++){
+                    uint64_t key=((uint64_t)ntohl(sources[i].sin_addr.s_addr)<<16) | ntohs(sources[i].sin_port);
+                    _sDevice &device=worker->devices[key];
+
+                    device.datagrams++;
+                    device.bytes+=messages[i].msg_len;
+                    device.decoder.feed(buffers[i], messages[i].msg_len, [&](const uint8_t *payload, uint16_t length){
+                        onFrame(device, payload, length);
+                        frames++;
+                    });
+                }
+            }
+            worker->datagrams+=received;
+            worker->frames+=frames;
+        }
+    }
+    close(epollFd);
+}
+
+/**
+ * @brief Colector con sus hilos
+ *
+ */
+class Collector
+{
+    public:
+        bool start(uint16_t port, unsigned threads){
+            workers=std::vector<_sWorker>(threads);
+            for(auto &worker : workers){
+                worker.fd=openCollectorSocket(port);
+                if(worker.fd<0){
+                    perror("socket del colector");
+                    return false;
+                }
+            }
+            for(auto &worker : workers)
+                worker.thread=std::thread(collectorWorker, &worker);
+            return true;
+        }
+        void stop(){
+            for(auto &worker : workers){
+                if(worker.thread.joinable())
+                    worker.thread.join();
+                close(worker.fd);
+            }
+        }
+        uint64_t frames(){
+            uint64_t total=0;
+            for(auto &worker : workers)
+                total+=worker.frames;
+            return total;
+        }
+        std::vector<uint64_t> framesPerWorker(){
+            std::vector<uint64_t> result;
+            for(auto &worker : workers)
+                result.push_back(worker.frames);
+            return result;
+        }
+        uint64_t lost(){
+            uint64_t total=0;
+            for(auto &worker : workers){
+                std::lock_guard<std::mutex> guard(worker.lock);
+                for(auto &device : worker.devices)
+                    total+=device.second.lost;
+            }
+            return total;
+        }
+        void printDevices(bool verbose){
+            uint64_t devices=0, badCheksum=0, lost=0, reordered=0;
+
+            if(verbose)
+                printf("%-21s %10s %10s %10s %10s %8s %8s\n", "equipo", "datagramas", "tramas", "alive", "telemetria", "perdidas", "cheksum");
+            for(auto &worker : workers){
+                std::lock_guard<std::mutex> guard(worker.lock);
+                for(auto &entry : worker.devices){
+                    const _sDevice &device=entry.second;
+                    char name[32];
+
+                    devices++;
+                    badCheksum+=device.decoder.badCheksum;
+                    lost+=device.lost;
+                    reordered+=device.reordered;
+                    if(!verbose)
+                        continue;
+                    snprintf(name, sizeof(name), "%u.%u.%u.%u:%u", (unsigned)(entry.first>>40) & 0xFF, (unsigned)(entry.first>>32) & 0xFF,
+                        (unsigned)(entry.first>>24) & 0xFF, (unsigned)(entry.first>>16) & 0xFF, (unsigned)entry.first & 0xFFFF);
+                    printf("%-21s %10llu %10llu %10llu %10llu %8llu %8llu\n", name, (unsigned long long)device.datagrams,
+                        (unsigned long long)device.frames, (unsigned long long)device.alive, (unsigned long long)device.telemetry,
+                        (unsigned long long)device.lost, (unsigned long long)device.decoder.badCheksum);
+                }
+            }
+            printf("equipos: %llu, tramas: %llu, perdidas por secuencia: %llu, desordenadas: %llu, errores de cheksum: %llu\n",
+                (unsigned long long)devices, (unsigned long long)frames(), (unsigned long long)lost,
+                (unsigned long long)reordered, (unsigned long long)badCheksum);
+        }
+    private:
+        std::vector<_sWorker> workers;
+};
+
+/*==================[ Generador ]============================================*/
+
+/**
+ * @brief Generador de carga, cada hilo atiende un grupo de equipos simulados
+ *
+ */
+class Generator
+{
+    public:
+        bool start(const char *address, uint16_t port, unsigned devices, double rate, unsigned threads){
+            struct sockaddr_in addr;
+
+            memset(&addr, 0, sizeof(addr));
+            addr.sin_family=AF_INET;
+            addr.sin_port=htons(port);
+            if(inet_pton(AF_INET, address, &addr.sin_addr)!=1){
+                fprintf(stderr, "dirección inválida: %s\n", address);
+                return false;
+            }
+            sockets.clear();
+            for(unsigned i=0; i<devices; i++){
+                int fd=socket(AF_INET, SOCK_DGRAM, 0);
+
+                // connect() le da a cada equipo su propio puerto de origen, como si fueran ESPs distintos
+                if((fd<0) || (connect(fd, (struct sockaddr *)&addr, sizeof(addr))<0)){
+                    perror("socket del generador");
+                    return false;
+                }
+                sockets.push_back(fd);
+            }
+            threads=std::max(1u, std::min(threads, devices));
+            sent=0;
+            for(unsigned t=0; t<threads; t++)
+                workers.emplace_back(&Generator::worker, this, t, threads, rate);
+            return true;
+        }
+        void stop(){
+            for(auto &worker : workers)
+                worker.join();
+            workers.clear();
+            for(int fd : sockets)
+                close(fd);
+            sockets.clear();
+        }
+        std::atomic<uint64_t> sent{0};
+    private:
+        void worker(unsigned index, unsigned threads, double rate){
+            std::vector<int> mine;
+            std::vector<uint32_t> sequence, frames;
+            uint8_t payload[3+4+TELEMETRYSAMPLES], frame[DATAGRAMLENGTH];
+            uint64_t count=0;
+            size_t length;
+            _clock::time_point start=_clock::now(), target;
+
+            for(size_t i=index; i<sockets.size(); i+=threads)
+                mine.push_back(sockets[i]);
+            sequence.assign(mine.size(), 0);
+            frames.assign(mine.size(), 0);
+            payload[0]=0x01;
+            payload[1]=0x00;
+
+            while(generating){
+                for(size_t d=0; (d<mine.size()) && generating; d++){
+                    if((++frames[d]%ALIVEEVERY)==0){
+                        payload[2]=GETALIVE;
+                        payload[3]=ACK;
+                        length=unerEncode(payload, 4, frame);
+                    }else{
+                        payload[2]=TELEMETRY;
+                        memcpy(&payload[3], &sequence[d], sizeof(uint32_t));
+                        for(uint8_t s=0; s<TELEMETRYSAMPLES; s++)
+                            payload[7+s]=(uint8_t)(sequence[d]+s);
+                        length=unerEncode(payload, sizeof(payload), frame);
+                        sequence[d]++;
+                    }
+                    // Si el socket está lleno la trama se pierde, igual que en un equipo real
+                    if(send(mine[d], frame, length, MSG_DONTWAIT)>0)
+                        sent++;
+                    count++;
+                }
+                if(rate>0){
+                    target=start+std::chrono::duration_cast<_clock::duration>(std::chrono::duration<double>(count/(rate*mine.size())));
+                    std::this_thread::sleep_until(target);
+                }
+            }
+        }
+        std::vector<int> sockets;
+        std::vector<std::thread> workers;
+};
+
+/*==================[ Modos ]============================================*/
+
+static int runCollect(uint16_t port, unsigned threads, unsigned seconds, bool verbose)
+{
+    Collector collector;
+    std::vector<uint64_t> last(threads, 0), now;
+    uint64_t total;
+
+    if(!collector.start(port, threads))
+        return 1;
+    printf("escuchando en UDP %u con %u hilos\n", port, threads);
+    for(unsigned s=1; (seconds==0) || (s<=seconds); s++){
+        std::this_thread::sleep_for(std::chrono::seconds(1));
+        now=collector.framesPerWorker();
+        total=0;
+        printf("t=%3us", s);
+        for(unsigned i=0; i<threads; i++){
+            printf(" h%u=%llu", i, (unsigned long long)(now[i]-last[i]));
+            total+=now[i]-last[i];
+        }
+        printf(" total=%llu tramas/s\n", (unsigned long long)total);
+        fflush(stdout);
+        last=now;
+    }
+    collecting=false;
+    collector.stop();
+    collector.printDevices(verbose);
+    return 0;
+}
+
+static int runGenerate(const char *address, uint16_t port, unsigned devices, double rate, unsigned threads, unsigned seconds)
+{
+    Generator generator;
+    uint64_t last=0, now;
+
+    if(!generator.start(address, port, devices, rate, threads))
+        return 1;
+    for(unsigned s=1; s<=seconds; s++){
+        std::this_thread::sleep_for(std::chrono::seconds(1));
+        now=generator.sent;
+        printf("t=%3us enviadas=%llu tramas/s\n", s, (unsigned long long)(now-last));
+        fflush(stdout);
+        last=now;
+    }
+    generating=false;
+    generator.stop();
+    printf("equipos: %u, tramas enviadas: %llu\n", devices, (unsigned long long)generator.sent);
+    return 0;
+}
+
+static int runBench(uint16_t port, unsigned devices, double rate, unsigned maxThreads, unsigned seconds)
+{
+    double base=0;
+
+    printf("%6s %14s %14s %8s %14s %8s\n", "hilos", "enviadas/s", "recibidas/s", "perdida", "por hilo/s", "escala");
+    for(unsigned threads=1; threads<=maxThreads; threads*=2){
+        Collector collector;
+        Generator generator;
+        uint64_t sent, received;
+        double perSecond;
+
+        collecting=true;
+        generating=true;
+        if(!collector.start(port, threads))
+            return 1;
+        if(!generator.start("127.0.0.1", port, devices, rate, threads)){
+            collecting=false;
+            collector.stop();
+            return 1;
+        }
+        std::this_thread::sleep_for(std::chrono::seconds(seconds));
+        generating=false;
+        generator.stop();
+        sent=generator.sent;
+        // Se da tiempo a que los hilos vacíen lo que quedó en los sockets
+        std::this_thread::sleep_for(std::chrono::milliseconds(200));
+        collecting=false;
+        collector.stop();
+        received=collector.frames();
+        perSecond=(double)received/seconds;
+        if(base==0)
+            base=perSecond;
+        printf("%6u %14.0f %14.0f %7.2f%% %14.0f %7.2fx\n", threads, (double)sent/seconds, perSecond,
+            sent ? 100.0*(double)(sent-std::min(sent, received))/sent : 0.0, perSecond/threads, base>0 ? perSecond/base : 0.0);
+        fflush(stdout);
+    }
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    const char *mode, *address="127.0.0.1";
+    uint16_t port=DEFAULTPORT;
+    unsigned threads=std::max(1u, std::thread::hardware_concurrency()), devices=16, seconds=0;
+    double rate=0;
+    bool verbose=false;
+    int opt;
+
+    if(argc<2){
+        fprintf(stderr, "uso: %s collect|generate|bench [opciones], ver el comentario de tools/udpcollector.cpp\n", argv[0]);
+        return 1;
+    }
+    mode=argv[1];
+    optind=2;
+    while((opt=getopt(argc, argv, "a:p:t:n:r:d:v"))!=-1){
+        switch(opt){
+            case 'a': address=optarg; break;
+            case 'p': port=atoi(optarg); break;
+            case 't': threads=std::max(1, atoi(optarg)); break;
+            case 'n': devices=std::max(1, atoi(optarg)); break;
+            case 'r': rate=atof(optarg); break;
+            case 'd': seconds=atoi(optarg); break;
+            case 'v': verbose=true; break;
+            default: return 1;
+        }
+    }
+
+    if(!strcmp(mode, "collect"))
+        return runCollect(port, threads, seconds, verbose);
+    if(!strcmp(mode, "generate"))
+        return runGenerate(address, port, devices, rate, threads, seconds ? seconds : 10);
+    if(!strcmp(mode, "bench"))
+        return runBench(port, devices, rate, threads, seconds ? seconds : 3);
+    fprintf(stderr, "modo desconocido: %s\n", mode);
+    return 1;
+}
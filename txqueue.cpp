@@ -0,0 +1,187 @@
+/*=============================================================================
+ * Copyright (c) 2021, Alejandro Rougier <alejandro.rougier@uner.edu.ar>
+ *
+ * All rights reserved.
+ * License: Free
+ * Date: 2021/11/12
+ * Version: v1.0
+ *===========================================================================*/
+
+/*==================[ Inclusions ]============================================*/
+
+#include "txqueue.h"
+
+/*==================[ Local variables ]============================================*/
+
+static const uint8_t blockEnd=FRAMEBLOCKSIZE;  //!< Indice de lectura fijo del FrameWriter, el bloque nunca da la vuelta
+
+static const uint8_t txClassWeight[TXCLASSES]={4, 2, 1};    //!< Tramas por ronda en TXWEIGHTED
+
+/*==================[ Local Functions ]============================================*/
+
+/**
+ * @brief Actualiza la marca de congestión de una clase
+ * Alta con 3/4 de la cola llena o sin bloques libres fuera de la reserva, baja con 1/4 de la cola y 1/4 del pool libre
+ *
+ * @param queue     Colas del canal
+ * @param txClass   Clase a revisar
+ */
+static void txClassWatermark(_sTxQueue *queue, _sTxClass *txClass)
+{
+    uint8_t freeBlocks=framePoolFree(queue->pool);
+
+    if(!txClass->congested && ((txClass->frameCount>=(TXFRAMESLENGTH-TXFRAMESLENGTH/4)) || (freeBlocks<=TXCONTROLRESERVE)))
+        txClass->congested=true;
+    else if(txClass->congested && (txClass->frameCount<=(TXFRAMESLENGTH/4)) && (freeBlocks>=(FRAMEPOOLBLOCKS/4)))
+        txClass->congested=false;
+}
+
+/**
+ * @brief Elige la clase de la próxima trama
+ *
+ * @param queue     Colas del canal
+ * @param now       Tiempo actual en ms
+ * @return int8_t   Clase elegida, -1 si no hay tramas
+ */
+static int8_t txQueueSchedule(_sTxQueue *queue, uint32_t now)
+{
+    int8_t selected=-1;
+    uint16_t age, oldest=0;
+    _sTxClass *txClass;
+
+    // Una trama que esperó demasiado sale primero, así las clases bajas nunca se quedan sin transmitir
+    for(uint8_t i=1; i<TXCLASSES; i++){
+        txClass=&queue->txClass[i];
+        if(txClass->frameCount==0)
+            continue;
+        age=(uint16_t)now-txClass->frameTime[txClass->frameHead];
+        if((age>=TXAGINGTIME) && (age>=oldest)){
+            oldest=age;
+            selected=i;
+        }
+    }
+    if(selected>=0)
+        return selected;
+
+#if TXSCHEDULER == TXWEIGHTED
+    for(uint8_t round=0; round<2; round++){
+        for(uint8_t i=0; i<TXCLASSES; i++){
+            if(queue->txClass[i].frameCount && queue->credits[i]){
+                queue->credits[i]--;
+                return i;
+            }
+        }
+        // Todas las clases con tramas agotaron su peso, empieza otra ronda
+        for(uint8_t i=0; i<TXCLASSES; i++)
+            queue->credits[i]=txClassWeight[i];
+    }
+#else
+    for(uint8_t i=0; i<TXCLASSES; i++){
+        if(queue->txClass[i].frameCount)
+            return i;
+    }
+#endif
+    return -1;
+}
+
+/*==================[ Functions ]============================================*/
+
+void txQueueInit(_sTxQueue *queue, _sFramePool *pool)
+{
+    memset(queue, 0, sizeof(_sTxQueue));
+    queue->pool=pool;
+    for(uint8_t i=0; i<TXCLASSES; i++){
+        queue->txClass[i].open=FRAMENONE;
+        queue->credits[i]=txClassWeight[i];
+    }
+}
+
+FrameWriter txQueueWriter(_sTxQueue *queue, uint8_t txClass, uint8_t framing)
+{
+    _sTxClass *cola=&queue->txClass[txClass];
+
+    cola->openLength=0;
+    if((cola->open==FRAMENONE) && ((txClass==TXCONTROL) || (framePoolFree(queue->pool)>TXCONTROLRESERVE)))
+        cola->open=frameAlloc(queue->pool);
+    // Sin bloque se arma sobre un buffer de tamaño 0: el FrameWriter queda desbordado y no escribe nada
+    if(cola->open==FRAMENONE)
+        return FrameWriter(&cola->openLength, 0, &cola->openLength, &cola->openLength, framing);
+    return FrameWriter(frameData(queue->pool, cola->open), 0xFF, &cola->openLength, &blockEnd, framing);
+}
+
+bool txQueueCommit(_sTxQueue *queue, uint8_t txClass, FrameWriter &frame, uint32_t now)
+{
+    _sTxClass *cola=&queue->txClass[txClass];
+    uint8_t indexCount;
+
+    if((cola->frameCount>=TXFRAMESLENGTH) || !frame.commit()){
+        cola->drops++;
+        frameFree(queue->pool, cola->open);
+        cola->open=FRAMENONE;
+        txClassWatermark(queue, cola);
+        return false;
+    }
+    indexCount=(cola->frameHead+cola->frameCount) % TXFRAMESLENGTH;
+    cola->frames[indexCount]=cola->open;
+    cola->frameLength[indexCount]=cola->openLength;
+    cola->frameTime[indexCount]=(uint16_t)now;
+    cola->frameCount++;
+    cola->open=FRAMENONE;
+    txClassWatermark(queue, cola);
+    return true;
+}
+
+void txQueueAbort(_sTxQueue *queue, uint8_t txClass)
+{
+    _sTxClass *cola=&queue->txClass[txClass];
+
+    if(cola->open==FRAMENONE)
+        return;
+    frameFree(queue->pool, cola->open);
+    cola->open=FRAMENONE;
+}
+
+int16_t txQueuePeek(_sTxQueue *queue, uint32_t now)
+{
+    _sTxClass *cola;
+    int8_t selected;
+
+    if(queue->remaining==0){
+        selected=txQueueSchedule(queue, now);
+        if(selected<0)
+            return -1;
+        queue->current=selected;
+        queue->indexSent=0;
+        queue->remaining=queue->txClass[selected].frameLength[queue->txClass[selected].frameHead];
+    }
+    cola=&queue->txClass[queue->current];
+    return frameData(queue->pool, cola->frames[cola->frameHead])[queue->indexSent];
+}
+
+void txQueuePop(_sTxQueue *queue)
+{
+    _sTxClass *cola=&queue->txClass[queue->current];
+
+    if(queue->remaining==0)
+        return;
+    queue->indexSent++;
+    queue->remaining--;
+    if(queue->remaining==0){
+        frameFree(queue->pool, cola->frames[cola->frameHead]);
+        cola->frameHead=(cola->frameHead+1) % TXFRAMESLENGTH;
+        cola->frameCount--;
+        txClassWatermark(queue, cola);
+    }
+}
+
+bool txQueueInFrame(const _sTxQueue *queue)
+{
+    return queue->remaining!=0;
+}
+
+bool txQueueCongested(_sTxQueue *queue, uint8_t txClass)
+{
+    // El pool es compartido, la marca puede cambiar por lo que hacen otros canales
+    txClassWatermark(queue, &queue->txClass[txClass]);
+    return queue->txClass[txClass].congested;
+}
@@ -0,0 +1,156 @@
+/*=============================================================================
+ * Copyright (c) 2021, Alejandro Rougier <alejandro.rougier@uner.edu.ar>
+ *
+ * All rights reserved.
+ * License: Free
+ * Date: 2021/11/12
+ * Version: v1.0
+ *===========================================================================*/
+
+/*==================[ Inclusions ]============================================*/
+
+#ifndef TXQUEUE_H
+#define TXQUEUE_H
+
+#include "mbed.h"
+#include "framewriter.h"
+#include "framepool.h"
+
+/*==================[ Macros ]============================================*/
+
+#define TXCLASSES           3       //!< Cantidad de clases de prioridad
+#define TXFRAMESLENGTH      8       //!< Tramas que se pueden encolar por clase
+#define TXCONTROLRESERVE    1       //!< Bloques del pool que solo puede usar la clase de control
+#define TXAGINGTIME         200     //!< ms que puede esperar una trama antes de pasar adelante de las de mayor prioridad
+
+/**
+ * @brief Política de planificación entre clases
+ * TXSTRICT: siempre sale la clase de mayor prioridad con tramas.
+ * TXWEIGHTED: en cada ronda cada clase puede sacar tantas tramas como su peso.
+ * En ambos casos una trama que espera más de TXAGINGTIME sale primero.
+ */
+#define TXSTRICT            0
+#define TXWEIGHTED          1
+#define TXSCHEDULER         TXSTRICT
+
+/*==================[ Global Variables ]============================================*/
+
+/**
+ * @brief Clases de prioridad de transmisión, de mayor a menor
+ *
+ */
+typedef enum{
+    TXCONTROL,          //!< Respuestas a comandos de control (ACK de STARTCONFIG, GETALIVE, ...)
+    TXINTERACTIVE,      //!< Respuestas a consultas del usuario
+    TXBULK              //!< Datos periódicos y telemetría
+}_eTxClass;
+
+/**
+ * @brief Cola de tramas de una clase, cada trama ocupa un bloque del pool
+ *
+ */
+typedef struct{
+    frameHandle frames[TXFRAMESLENGTH];     //!< Bloque de cada trama encolada
+    uint8_t frameLength[TXFRAMESLENGTH];    //!< Longitud de cada trama encolada
+    uint16_t frameTime[TXFRAMESLENGTH];     //!< Momento en que se encoló cada trama (ms)
+    uint8_t frameHead;                      //!< Primera trama encolada
+    uint8_t frameCount;                     //!< Cantidad de tramas encoladas
+    uint8_t congested;                      //!< Se superó la marca alta y todavía no se bajó de la baja
+    uint16_t drops;                         //!< Tramas descartadas completas por falta de lugar
+    frameHandle open;                       //!< Bloque de la trama que se está armando
+    uint8_t openLength;                     //!< Indice de escritura del FrameWriter, al publicar es la longitud
+}_sTxClass;
+
+/**
+ * @brief Colas de transmisión de un canal
+ *
+ */
+typedef struct{
+    _sFramePool *pool;                      //!< Pool compartido de donde salen los bloques
+    _sTxClass txClass[TXCLASSES];           //!< Colas de cada clase
+    uint8_t current;                        //!< Clase de la trama que se está transmitiendo
+    uint8_t remaining;                      //!< Bytes que faltan de la trama en curso
+    uint8_t indexSent;                      //!< Próximo byte a transmitir de la trama en curso
+    uint8_t credits[TXCLASSES];             //!< Tramas que le quedan a cada clase en la ronda (TXWEIGHTED)
+}_sTxQueue;
+
+/*==================[ Functions ]============================================*/
+
+/**
+ * @brief Inicializa las colas de un canal
+ *
+ * @param queue Colas del canal
+ * @param pool  Pool de bloques compartido con los demás canales
+ */
+void txQueueInit(_sTxQueue *queue, _sFramePool *pool);
+
+/**
+ * @brief Prepara un FrameWriter que escribe directo en un bloque del pool
+ * Una trama que no se publicó se descarta al pedir otro FrameWriter de la misma clase y su bloque se reutiliza;
+ * si no se va a publicar hay que llamar a txQueueAbort() para devolver el bloque al pool.
+ * Si no hay bloques, o solo quedan los reservados para TXCONTROL, el FrameWriter nace desbordado y commit() falla.
+ *
+ * @param queue     Colas del canal
+ * @param txClass   Clase de la trama (_eTxClass)
+ * @param framing   Entramado del canal
+ * @return FrameWriter
+ */
+FrameWriter txQueueWriter(_sTxQueue *queue, uint8_t txClass, uint8_t framing);
+
+/**
+ * @brief Publica la trama armada con txQueueWriter() en la cola de su clase
+ *
+ * @param queue     Colas del canal
+ * @param txClass   Clase de la trama, la misma que se usó en txQueueWriter()
+ * @param frame     Trama armada
+ * @param now       Tiempo actual en ms
+ * @return true     La trama quedó encolada
+ * @return false    La trama se descartó completa y se contó en drops
+ */
+bool txQueueCommit(_sTxQueue *queue, uint8_t txClass, FrameWriter &frame, uint32_t now);
+
+/**
+ * @brief Descarta la trama armada con txQueueWriter() sin publicarla y devuelve su bloque al pool
+ * No cuenta como descarte en drops
+ *
+ * @param queue     Colas del canal
+ * @param txClass   Clase de la trama
+ */
+void txQueueAbort(_sTxQueue *queue, uint8_t txClass);
+
+/**
+ * @brief Devuelve el próximo byte a transmitir, eligiendo la clase solo al comienzo de cada trama
+ *
+ * @param queue     Colas del canal
+ * @param now       Tiempo actual en ms
+ * @return int16_t  Byte a transmitir, -1 si no hay nada para transmitir
+ */
+int16_t txQueuePeek(_sTxQueue *queue, uint32_t now);
+
+/**
+ * @brief Quita el byte que devolvió txQueuePeek() una vez que se transmitió
+ *
+ * @param queue     Colas del canal
+ */
+void txQueuePop(_sTxQueue *queue);
+
+/**
+ * @brief Consulta si hay una trama a medio transmitir
+ *
+ * @param queue     Colas del canal
+ * @return true     Falta terminar la trama en curso
+ * @return false    El próximo byte es el comienzo de una trama
+ */
+bool txQueueInFrame(const _sTxQueue *queue);
+
+/**
+ * @brief Consulta si la clase está congestionada para que los productores dejen de generar tramas
+ *
+ * @param queue     Colas del canal
+ * @param txClass   Clase a consultar
+ * @return true     La clase superó la marca alta
+ * @return false    Se pueden seguir generando tramas
+ */
+bool txQueueCongested(_sTxQueue *queue, uint8_t txClass);
+
+#endif
@@ -10,106 +10,60 @@
 /*==================[ Inclusions ]============================================*/
 
 #include "wifi.h"
+#include "config.h"
 /*==================[ Local MAcros ]============================================*/
 #define STARTUPTIME     10000
 #define TIMETOCHECK     8000
 #define RESETTIME       500
 
-static uint16_t delayrespuesta=10;
-#define DELAYRESPONSE  delayrespuesta
-
-/*==================[ Local variables ]============================================*/
-uint8_t *buffRx;                    //!< Puntero local al bufer circular de recepción
-uint8_t *indexRxWrite;              //!< Puntero local al indice de escritura del bufer circular de recepción
-static uint32_t maxBufferLength;    //!< Variable local tamaño del bufer circular de recepción
-static wifiData *dataConfigwifi;    //!< Puntero local a los datos de configuración
-static bool configActive=false;     //!< Flag de configuración activa
-static bool startUpActive=true;     //!< Flag de inicio de chequeo del ESP
-static uint8_t numTimeSend, numTimeRecive;
-static uint8_t wifiReady=false;
-/*==================[ Local Prototypes ]============================================*/
-/**
- * @brief Función que se  llama cuando ocurre la IRQ_Rx
- * 
- */
-static void onDataRx();
-
-/*==================[ Local typedef ]============================================*/
-
-/**
- * @brief Estructura para manejar la trasnmisión, recepción de datos del ESP
- * 
- */
-typedef struct{
-    uint8_t estado;           //!< Indica cual es el estado de la transmisión durante la configuración 
-    uint8_t indexWriteRx;    //!< Indice de escritura del buffer circular de recepción
-    uint8_t indexReadRx;     //!< Indice de lectura del buffer circular de recepción
-    uint8_t indexWriteTx;    //!< Indice de escritura del buffer circular de transmisión
-    uint8_t indexReadTx;     //!< Indice de lectura del buffer circular de transmisión
-    uint8_t bufferRx[256];   //!< Buffer circular de recepción
-    uint8_t bufferTx[256];   //!< Buffer circular de transmisión
-}_sDatoConfig ;
-
-static _sDatoConfig esp8266Data;
-
-/**
- * @brief Enumeración para la MEF de configuración del ESP
- * 
- */
-typedef enum{
-			CWMODE_DEF,
-			CWDHCP_DEF,
-			CWJAP_DEF,
-            CIPMUX,
-			CIFSR,
-			CIPSTART,
-			CIPMODE,
-			CIPSEND,
-			AWAITINGRESPONSE,
-			INCOMMINGRESPONSE,
-            READYTOTRASMIT,
-			AUTOMATIC
-} _eEstadoESP;
-
-static _eEstadoESP espState=CWMODE_DEF;
-
-/**
- * @brief Enumeración de la MEF de las tareas comunes de la clase Wifi
- * 
- */
-typedef enum{
-        RESETWIFI,
-        STARTUP,
-        STANBY,
-        CONFIG,
-        READY
-}_eStateTask;
-
-static _eStateTask wifiTaskState;
-
-/*==================[ other Variables ]============================================*/
-Timer timerWifi;
-
-uint32_t timeWifi=0;
-
-uint32_t timestartUp=0;
-
-uint32_t timerReset=0;
-
-DigitalOut chipEnableESP(PA_3);
-
-RawSerial wifiCom(PB_10,PB_11,115200);
+#define DELAYRESPONSE  delayRespuesta
+
+#define ATGUARDTIME     20      //!< Silencio previo al "+++" para que el ESP lo tome como paquete aparte
+#define ATEXITTIME      1000    //!< Espera luego del "+++" antes de enviar comandos
+#define ATRESUMETIME    2000    //!< Espera máxima del '>' al volver al modo transparente
+
+#define TXHIGHWATER     192     //!< Bytes ocupados en el buffer de transmisión para avisar congestión
+#define TXLOWWATER      64      //!< Bytes ocupados en el buffer de transmisión para avisar que se liberó
+
+#define RXHIGHWATER     192     //!< Bytes ocupados en el buffer de recepción para detener al ESP con RTS
+#define RXLOWWATER      64      //!< Bytes ocupados en el buffer de recepción para volver a habilitarlo
+
+#define SCANTIME        6000    //!< Espera máxima de la respuesta de AT+CWLAP
+#define ROAMSTATUSTIME  2000    //!< Espera máxima de la respuesta de AT+CWJAP?
+#define ROAMJOINTIME    15000   //!< Espera máxima para conectarse al nuevo AP
+#define ROAMSTARTTIME   3000    //!< Espera máxima para reabrir la conexión
 
 /*==================[ Public Methods ]============================================*/
 
-Wifi::Wifi(uint8_t *buff, uint8_t *indexWRx, uint32_t lengthBuff)
+Wifi::Wifi(RawSerial &serial, DigitalOut &chipEnable, uint8_t *buff, uint8_t *indexWRx, const uint8_t *indexRRx, uint32_t lengthBuff)
+    : wifiCom(serial), chipEnableESP(chipEnable)
 {
     buffRx=buff;
     indexRxWrite=indexWRx;
+    indexRxRead=indexRRx;
     maxBufferLength=lengthBuff;
     esp8266Data.indexReadRx=esp8266Data.indexReadTx=esp8266Data.indexWriteRx=esp8266Data.indexWriteTx=0;
     wifiTaskState=RESETWIFI;
+    espState=CWMODE_DEF;
     numTimeSend=numTimeRecive=0;
+    dataConfigwifi=NULL;
+    configActive=false;
+    startUpActive=true;
+    wifiReady=false;
+    delayRespuesta=10;
+    timeWifi=timestartUp=timerReset=timeLastTx=0;
+    atActive=false;
+    atPtr=NULL;
+    atHead=atCount=0;
+    atLength=atLineLength=0;
+    timeScan=timeRoam=0;
+    roamBusy=false;
+    txCongested=false;
+    rxOverruns=0;
+    rtsESP=NULL;
+    rxStopped=false;
+    apScanInit(&apScan, NULL, 0);
+    memset(&apActual, 0, sizeof(apActual));
 }
 
 Wifi::~Wifi()
@@ -125,13 +79,41 @@ void Wifi::configWifi(wifiData *dataconfig){
     wifiReady=false;
 }
 
-void Wifi::writeWifiData(uint8_t *buff, uint8_t nBytes){
+uint8_t Wifi::writeWifiData(uint8_t *buff, uint8_t nBytes){
+    uint8_t freeBytes=txFree();
+
+    // Mientras se configura el buffer lleva los comandos AT, los datos esperan en el canal
+    if(!wifiReady)
+        return 0;
+    if(nBytes>freeBytes)
+        nBytes=freeBytes;
     for(uint8_t i=0; i<nBytes; i++)
         esp8266Data.bufferTx[esp8266Data.indexWriteTx++]=buff[i];
+    checkTxWatermark();
+    return nBytes;
+}
+
+uint8_t Wifi::isTxCongested(){
+    return txCongested;
+}
+
+uint8_t Wifi::txPending(){
+    return esp8266Data.indexWriteTx-esp8266Data.indexReadTx;
+}
+
+void Wifi::attachTxWatermark(Callback<void(bool)> watermark){
+    txWatermark=watermark;
 }
 
 
 void Wifi::taskWifi(){
+
+    // RTS se vuelve a habilitar acá porque el buffer se vacía leyendo, no en la IRQ
+    if(rxStopped){
+        core_util_critical_section_enter();
+        updateRts();
+        core_util_critical_section_exit();
+    }
     
     switch (wifiTaskState)
     {
@@ -182,8 +164,56 @@ void Wifi::taskWifi(){
         }
         break;
     case READY:
-        if(esp8266Data.indexReadTx!=esp8266Data.indexWriteTx)
+#if WIFIROAMING
+        if(!roamBusy && ((timerWifi.read_ms()-timeRoam)>=ROAMINTERVAL)){
+            timeRoam=timerWifi.read_ms();
+            roamBusy=sendATCommand("AT+CWJAP?\r\n", ROAMSTATUSTIME, callback(this, &Wifi::onRoamStatus));
+        }
+#endif
+        if(esp8266Data.indexReadTx!=esp8266Data.indexWriteTx){
             wifiSend();
+            timeLastTx=timerWifi.read_ms();
+        }else if(atCount && ((timerWifi.read_ms()-timeLastTx)>=ATGUARDTIME)){
+            atActive=true;
+            atPtr="+++";
+            timeWifi=timerWifi.read_ms();
+            wifiTaskState=ATEXIT;
+        }
+        break;
+    case ATEXIT:
+        if(atSend() && ((timerWifi.read_ms()-timeWifi)>=ATEXITTIME)){
+            esp8266Data.indexReadRx=esp8266Data.indexWriteRx;
+            atStart();
+            wifiTaskState=ATCOMMAND;
+        }
+        break;
+    case ATCOMMAND:
+        if(atSend()){
+            int8_t status=atReceive();
+            if(status>=0){
+                atFinish(status);
+            }else if((timerWifi.read_ms()-timeWifi)>=atQueue[atHead].timeOut){
+                atFinish(ATCMDTIMEOUT);
+            }
+        }
+        break;
+    case ATRESUME:
+        if(atSend()){
+            while(esp8266Data.indexReadRx!=esp8266Data.indexWriteRx){
+                if(esp8266Data.bufferRx[esp8266Data.indexReadRx++]=='>'){
+                    atActive=false;
+                    timeLastTx=timerWifi.read_ms();
+                    wifiTaskState=READY;
+                    break;
+                }
+            }
+            // Sin '>' el módulo quedó en un estado desconocido: se reinicia y se vuelve a configurar
+            if(atActive && ((timerWifi.read_ms()-timeWifi)>=ATRESUMETIME)){
+                resetWifi();
+                if(dataConfigwifi!=NULL)
+                    configWifi(dataConfigwifi);
+            }
+        }
         break;
     default:
         break;
@@ -196,7 +226,7 @@ uint8_t Wifi::isWifiReady(){
 
 void Wifi::initTask(){
     chipEnableESP.write(true);
-    wifiCom.attach (&onDataRx, RawSerial::RxIrq);
+    wifiCom.attach(callback(this, &Wifi::onDataRx), RawSerial::RxIrq);
     timerWifi.start();
     timestartUp=timerWifi.read_ms();
     timerReset=timerWifi.read_us();
@@ -204,12 +234,221 @@ void Wifi::initTask(){
 
 void Wifi::resetWifi(){
     wifiTaskState=RESETWIFI;
+    atActive=false;
+    atPtr=NULL;
+    while(atCount){
+        _sAtCommand *cmd=&atQueue[atHead];
+        atHead=(atHead+1)%ATQUEUELENGTH;
+        atCount--;
+        if(cmd->done)
+            cmd->done(ATCMDERROR, NULL, 0);
+    }
+    // Lo que quedó sin transmitir, datos o respuestas de los callbacks, no puede ir en medio de la configuración
+    wifiReady=false;
+    esp8266Data.indexReadTx=esp8266Data.indexWriteTx;
+    checkTxWatermark();
+}
+
+bool Wifi::sendATCommand(const char *command, uint16_t timeOut, atCallback done, atDataCallback onData){
+    _sAtCommand *cmd;
+
+    if(atCount>=ATQUEUELENGTH)
+        return false;
+    cmd=&atQueue[(atHead+atCount)%ATQUEUELENGTH];
+    cmd->command=command;
+    cmd->timeOut=timeOut;
+    cmd->done=done;
+    cmd->onData=onData;
+    atCount++;
+    return true;
 }
 /*==================[ Private c Methods ]============================================*/
 
 void Wifi::wifiSend(){
-    if(wifiCom.writeable())
+    if(wifiCom.writeable()){
+        if(captureHook)
+            captureHook(true, esp8266Data.bufferTx[esp8266Data.indexReadTx]);
         wifiCom.putc(esp8266Data.bufferTx[esp8266Data.indexReadTx++]);
+        checkTxWatermark();
+    }
+}
+
+uint8_t Wifi::txFree(){
+    return esp8266Data.indexReadTx-esp8266Data.indexWriteTx-1;
+}
+
+void Wifi::checkTxWatermark(){
+    uint8_t used=esp8266Data.indexWriteTx-esp8266Data.indexReadTx;
+
+    if(!txCongested && (used>=TXHIGHWATER)){
+        txCongested=true;
+        if(txWatermark)
+            txWatermark(true);
+    }else if(txCongested && (used<=TXLOWWATER)){
+        txCongested=false;
+        if(txWatermark)
+            txWatermark(false);
+    }
+}
+
+bool Wifi::wifiWriteCommand(const uint8_t *command, uint8_t maxLength){
+    uint8_t length=0;
+
+    while(length<maxLength){
+        if(command[length++]=='\n')
+            break;
+    }
+    if(length>txFree())
+        return false;
+    for(uint8_t i=0; i<length; i++)
+        esp8266Data.bufferTx[esp8266Data.indexWriteTx++]=command[i];
+    return true;
+}
+
+bool Wifi::atSend(){
+    if((atPtr!=NULL) && (*atPtr!='\0')){
+        if(wifiCom.writeable()){
+            if(captureHook)
+                captureHook(true, *atPtr);
+            wifiCom.putc(*atPtr++);
+        }
+        return false;
+    }
+    return true;
+}
+
+void Wifi::atStart(){
+    atPtr=atQueue[atHead].command;
+    atLength=atLineLength=0;
+    timeWifi=timerWifi.read_ms();
+}
+
+int8_t Wifi::atReceive(){
+    uint8_t dato;
+
+    while(esp8266Data.indexReadRx!=esp8266Data.indexWriteRx){
+        dato=esp8266Data.bufferRx[esp8266Data.indexReadRx++];
+        if(atQueue[atHead].onData)
+            atQueue[atHead].onData(dato);
+        if(atLineLength<ATLINELENGTH)
+            atLine[atLineLength++]=dato;
+        if(dato!='\n'){
+            if(atLength<ATRESPONSELENGTH)
+                atResponse[atLength++]=dato;
+            continue;
+        }
+        if((atLineLength==4) && !memcmp(atLine, "OK\r\n", 4))
+            return ATCMDOK;
+        if(((atLineLength==7) && !memcmp(atLine, "ERROR\r\n", 7)) || ((atLineLength==6) && !memcmp(atLine, "FAIL\r\n", 6)))
+            return ATCMDERROR;
+        // La línea no es final, queda en la respuesta
+        if(atLength<ATRESPONSELENGTH)
+            atResponse[atLength++]=dato;
+        atLineLength=0;
+    }
+    return -1;
+}
+
+void Wifi::atFinish(uint8_t status){
+    _sAtCommand *cmd=&atQueue[atHead];
+    uint8_t length=atLength;
+
+    // Se quita de la respuesta la parte de la línea final que ya se había guardado
+    if(status!=ATCMDTIMEOUT)
+        length=(atLength>=(atLineLength-1)) ? atLength-(atLineLength-1) : 0;
+    atHead=(atHead+1)%ATQUEUELENGTH;
+    atCount--;
+    if(cmd->done)
+        cmd->done(status, atResponse, length);
+
+    // El callback pudo haber reseteado el módulo
+    if(wifiTaskState!=ATCOMMAND)
+        return;
+    if(atCount){
+        atStart();
+    }else{
+        atPtr="AT+CIPSEND\r\n";
+        timeWifi=timerWifi.read_ms();
+        esp8266Data.indexReadRx=esp8266Data.indexWriteRx;
+        wifiTaskState=ATRESUME;
+    }
+}
+
+bool Wifi::wifiWriteString(const char *cadena){
+    if(strlen(cadena)>txFree())
+        return false;
+    while(*cadena!='\0')
+        esp8266Data.bufferTx[esp8266Data.indexWriteTx++]=*cadena++;
+    return true;
+}
+
+void Wifi::startScan(){
+    uint8_t start=0, length=0;
+
+    // cwjap tiene la forma AT+CWJAP_DEF="<ssid>","<pwd>"
+    if(dataConfigwifi!=NULL){
+        while((start<sizeof(dataConfigwifi->cwjap)) && (dataConfigwifi->cwjap[start]!='"'))
+            start++;
+        start++;
+        while(((start+length)<sizeof(dataConfigwifi->cwjap)) && (dataConfigwifi->cwjap[start+length]!='"'))
+            length++;
+        if((start+length)>=sizeof(dataConfigwifi->cwjap))
+            length=0;
+    }
+    apScanInit(&apScan, (length>0) ? &dataConfigwifi->cwjap[start] : NULL, length);
+}
+
+void Wifi::onRoamStatus(uint8_t status, const uint8_t *response, uint8_t length){
+    if((status==ATCMDOK) && apParseJoined(response, length, &apActual) && (apActual.rssi<ROAMTHRESHOLD)){
+        startScan();
+        if(apScan.ssidLength && sendATCommand("AT+CWLAP\r\n", SCANTIME, callback(this, &Wifi::onRoamScan), callback(this, &Wifi::onRoamData)))
+            return;
+    }
+    roamBusy=false;
+}
+
+void Wifi::onRoamData(uint8_t dato){
+    apScanByte(&apScan, dato);
+}
+
+void Wifi::onRoamScan(uint8_t status, const uint8_t *response, uint8_t length){
+    const _sApInfo *best=apScanBest(&apScan);
+    char bssid[APBSSIDTEXT];
+    uint8_t indexIn=0, indexOut;
+
+    roamBusy=false;
+    if((status!=ATCMDOK) || (best==NULL) || !memcmp(best->bssid, apActual.bssid, sizeof(best->bssid)) ||
+        (best->rssi<(apActual.rssi+ROAMHYSTERESIS)) || ((atCount+2)>ATQUEUELENGTH))
+        return;
+
+    // AT+CWJAP_CUR=<argumentos de cwjap>,"<bssid>" para no grabar la flash en cada cambio de AP
+    indexOut=strlen("AT+CWJAP_CUR=");
+    memcpy(roamJoin, "AT+CWJAP_CUR=", indexOut);
+    while((indexIn<sizeof(dataConfigwifi->cwjap)) && (dataConfigwifi->cwjap[indexIn]!='='))
+        indexIn++;
+    for(indexIn++; (indexIn<sizeof(dataConfigwifi->cwjap)) && (indexOut<(sizeof(roamJoin)-APBSSIDTEXT-6)); indexIn++){
+        if((dataConfigwifi->cwjap[indexIn]=='\r') || (dataConfigwifi->cwjap[indexIn]=='\n'))
+            break;
+        roamJoin[indexOut++]=dataConfigwifi->cwjap[indexIn];
+    }
+    apFormatBssid(best->bssid, bssid);
+    roamJoin[indexOut++]=',';
+    roamJoin[indexOut++]='"';
+    memcpy(&roamJoin[indexOut], bssid, APBSSIDTEXT-1);
+    indexOut+=APBSSIDTEXT-1;
+    memcpy(&roamJoin[indexOut], "\"\r\n", 4);
+
+    for(indexOut=0; (indexOut<sizeof(dataConfigwifi->cipstart)) && (indexOut<(sizeof(roamStart)-1)); indexOut++){
+        roamStart[indexOut]=dataConfigwifi->cipstart[indexOut];
+        if(dataConfigwifi->cipstart[indexOut]=='\n'){
+            indexOut++;
+            break;
+        }
+    }
+    roamStart[indexOut]='\0';
+
+    sendATCommand(roamJoin, ROAMJOINTIME, atCallback());
+    sendATCommand(roamStart, ROAMSTARTTIME, atCallback());
 }
 
 void Wifi::configWifiMef(wifiData *parameters){
@@ -218,11 +457,8 @@ void Wifi::configWifiMef(wifiData *parameters){
     {
     case CWMODE_DEF:
         if(esp8266Data.estado==READYTOTRASMIT){
-            for(uint8_t i=0; i < (sizeof(parameters->cwmode));i++){
-                esp8266Data.bufferTx[esp8266Data.indexWriteTx++]=parameters->cwmode[i];
-                if(parameters->cwmode[i]=='\n')
-                    break;
-            }
+            if(!wifiWriteCommand(parameters->cwmode, sizeof(parameters->cwmode)))
+                break;
             esp8266Data.estado=AWAITINGRESPONSE;
             numTimeSend++;
         }else{
@@ -237,31 +473,56 @@ void Wifi::configWifiMef(wifiData *parameters){
         break;
     case CWDHCP_DEF:
         if(esp8266Data.estado==READYTOTRASMIT){
-                for(uint8_t i=0; i < (sizeof(parameters->cwdhcp));i++){
-                    esp8266Data.bufferTx[esp8266Data.indexWriteTx++]=parameters->cwdhcp[i];
-                    if(parameters->cwdhcp[i]=='\n')
-                        break;
-                }
+                if(!wifiWriteCommand(parameters->cwdhcp, sizeof(parameters->cwdhcp)))
+                    break;
                 esp8266Data.estado=AWAITINGRESPONSE;
                  numTimeSend++;
         }else{
             if (wifiResponse("OK\0",false)){
                  numTimeRecive=numTimeSend=0;
                 esp8266Data.estado=READYTOTRASMIT;
-                espState=CWJAP_DEF;
+                espState=CWLAP;
             }else{
                 numTimeRecive++;
             }
             
         }
     break;
+    case CWLAP: //Busca los APs del SSID configurado para conectarse al de mejor señal
+        if(esp8266Data.estado==READYTOTRASMIT){
+                if(!wifiWriteString("AT+CWLAP\r\n"))
+                    break;
+                startScan();
+                esp8266Data.estado=AWAITINGRESPONSE;
+                timeScan=timerWifi.read_ms();
+                numTimeSend++;
+        }else{
+            while(esp8266Data.indexReadRx!=esp8266Data.indexWriteRx)
+                apScanByte(&apScan, esp8266Data.bufferRx[esp8266Data.indexReadRx++]);
+            if(apScan.done || ((timerWifi.read_ms()-timeScan)>=SCANTIME)){
+                numTimeRecive=numTimeSend=0;
+                esp8266Data.estado=READYTOTRASMIT;
+                espState=CWJAP_DEF;
+            }
+        }
+        break;
     case CWJAP_DEF:
         if(esp8266Data.estado==READYTOTRASMIT){
+                if(txFree()<(sizeof(parameters->cwjap)+APBSSIDTEXT+4))
+                    break;
                 for(uint8_t i=0; i < (sizeof(parameters->cwjap));i++){
-                    esp8266Data.bufferTx[esp8266Data.indexWriteTx++]=parameters->cwjap[i];
-                    if(parameters->cwjap[i]=='\n')
+                    if((parameters->cwjap[i]=='\r') || (parameters->cwjap[i]=='\n'))
                         break;
+                    esp8266Data.bufferTx[esp8266Data.indexWriteTx++]=parameters->cwjap[i];
                 }
+                if(apScanBest(&apScan)!=NULL){
+                    char bssid[APBSSIDTEXT];
+                    apFormatBssid(apScanBest(&apScan)->bssid, bssid);
+                    wifiWriteString(",\"");
+                    wifiWriteString(bssid);
+                    wifiWriteString("\"");
+                }
+                wifiWriteString("\r\n");
                 esp8266Data.estado=AWAITINGRESPONSE;
                 DELAYRESPONSE=5000;
                 numTimeSend++;
@@ -278,11 +539,8 @@ void Wifi::configWifiMef(wifiData *parameters){
         break;
     case CIPMUX:
         if(esp8266Data.estado==READYTOTRASMIT){
-                for(uint8_t i=0; i < (sizeof(parameters->cipmux));i++){
-                    esp8266Data.bufferTx[esp8266Data.indexWriteTx++]=parameters->cipmux[i];
-                    if(parameters->cipmux[i]=='\n')
-                        break;
-                }
+                if(!wifiWriteCommand(parameters->cipmux, sizeof(parameters->cipmux)))
+                    break;
                 esp8266Data.estado=AWAITINGRESPONSE;
                 numTimeSend++;
         }else{
@@ -297,11 +555,8 @@ void Wifi::configWifiMef(wifiData *parameters){
         break;
     case CIPSTART:
         if(esp8266Data.estado==READYTOTRASMIT){
-                for(uint8_t i=0; i < (sizeof(parameters->cipstart));i++){
-                    esp8266Data.bufferTx[esp8266Data.indexWriteTx++]=parameters->cipstart[i];
-                    if(parameters->cipstart[i]=='\n')
-                        break;
-                }
+                if(!wifiWriteCommand(parameters->cipstart, sizeof(parameters->cipstart)))
+                    break;
                 esp8266Data.estado=AWAITINGRESPONSE;
                 DELAYRESPONSE=1500;
                 numTimeSend++;
@@ -318,11 +573,8 @@ void Wifi::configWifiMef(wifiData *parameters){
         break;
     case CIPMODE:
         if(esp8266Data.estado==READYTOTRASMIT){
-                for(uint8_t i=0; i < (sizeof(parameters->cipmode));i++){
-                    esp8266Data.bufferTx[esp8266Data.indexWriteTx++]=parameters->cipmode[i];
-                    if(parameters->cipmode[i]=='\n')
-                        break;
-                }
+                if(!wifiWriteCommand(parameters->cipmode, sizeof(parameters->cipmode)))
+                    break;
                 esp8266Data.estado=AWAITINGRESPONSE;
                  numTimeSend++;
         }else{
@@ -338,11 +590,8 @@ void Wifi::configWifiMef(wifiData *parameters){
         break;
     case CIPSEND:
         if(esp8266Data.estado==READYTOTRASMIT){
-                for(uint8_t i=0; i < (sizeof(parameters->cipsend));i++){
-                    esp8266Data.bufferTx[esp8266Data.indexWriteTx++]=parameters->cipsend[i];
-                    if(parameters->cipsend[i]=='\n')
-                        break;
-                }
+                if(!wifiWriteCommand(parameters->cipsend, sizeof(parameters->cipsend)))
+                    break;
                 esp8266Data.estado=AWAITINGRESPONSE;
                  numTimeSend++;
         }else{
@@ -356,6 +605,7 @@ void Wifi::configWifiMef(wifiData *parameters){
         }
         break;
     case AUTOMATIC:
+        timeRoam=timerWifi.read_ms();
         wifiTaskState=READY;
         configActive=false;
         wifiReady=true;
@@ -391,18 +641,72 @@ bool Wifi::wifiResponse(const char *subcadena, unsigned char stopSearch){
     return respuesta;        
 }
 
+void Wifi::enableFlowControl(DigitalOut *rts, PinName cts){
+    rtsESP=rts;
+    rxStopped=false;
+    if(rtsESP!=NULL)
+        rtsESP->write(0);
+    if(cts!=NC)
+        wifiCom.set_flow_control(SerialBase::CTS, cts);
+}
+
+uint16_t Wifi::getRxOverruns(){
+    return rxOverruns;
+}
+
+void Wifi::attachCapture(Callback<void(bool, uint8_t)> capture){
+    captureHook=capture;
+}
+
+uint16_t Wifi::rxUsed(){
+    if(configActive || startUpActive || atActive)
+        return (uint8_t)(esp8266Data.indexWriteRx-esp8266Data.indexReadRx);
+    return (*indexRxWrite+maxBufferLength-*indexRxRead) % maxBufferLength;
+}
+
+void Wifi::updateRts(){
+    uint16_t used;
+
+    if(rtsESP==NULL)
+        return;
+    used=rxUsed();
+    if(!rxStopped && (used>=RXHIGHWATER)){
+        rtsESP->write(1);
+        rxStopped=true;
+    }else if(rxStopped && (used<=RXLOWWATER)){
+        rtsESP->write(0);
+        rxStopped=false;
+    }
+}
+
 /*==================[ others Methods ]============================================*/
-static void onDataRx(){
+void Wifi::onDataRx(){
+    uint8_t dato;
+    uint32_t next;
+
     while (wifiCom.readable())
     {
-        if(configActive || startUpActive){
-            esp8266Data.bufferRx[esp8266Data.indexWriteRx++]=wifiCom.getc();
+        dato=wifiCom.getc();
+        if(captureHook)
+            captureHook(false, dato);
+        // Con el buffer lleno se descarta el byte nuevo, pisar uno sin leer desincroniza al decodificador
+        if(configActive || startUpActive || atActive){
+            if((uint8_t)(esp8266Data.indexWriteRx+1)!=esp8266Data.indexReadRx)
+                esp8266Data.bufferRx[esp8266Data.indexWriteRx++]=dato;
+            else if(rxOverruns<0xFFFF)
+                rxOverruns++;
         }
         else{
-            buffRx[*indexRxWrite]=wifiCom.getc();
-            *indexRxWrite=*indexRxWrite+1;
-            if (*indexRxWrite > maxBufferLength)
-                *indexRxWrite=0;
+            next=*indexRxWrite+1;
+            if(next>=maxBufferLength)
+                next=0;
+            if(next!=*indexRxRead){
+                buffRx[*indexRxWrite]=dato;
+                *indexRxWrite=next;
+            }else if(rxOverruns<0xFFFF){
+                rxOverruns++;
+            }
         }
     }
+    updateRts();
 }
@@ -13,6 +13,7 @@
 #define WIFI_H
 
 #include "mbed.h"
+#include "apscan.h"
 
 /*==================[ Global Variables ]============================================*/
 #pragma pack(1)
@@ -28,6 +29,92 @@
     } wifiData;
 #pragma pack(0)
 
+/**
+ * @brief Estructura para manejar la trasnmisión, recepción de datos del ESP
+ * 
+ */
+typedef struct{
+    uint8_t estado;           //!< Indica cual es el estado de la transmisión durante la configuración 
+    uint8_t indexWriteRx;    //!< Indice de escritura del buffer circular de recepción
+    uint8_t indexReadRx;     //!< Indice de lectura del buffer circular de recepción
+    uint8_t indexWriteTx;    //!< Indice de escritura del buffer circular de transmisión
+    uint8_t indexReadTx;     //!< Indice de lectura del buffer circular de transmisión
+    uint8_t bufferRx[256];   //!< Buffer circular de recepción
+    uint8_t bufferTx[256];   //!< Buffer circular de transmisión
+}_sDatoConfig ;
+
+/**
+ * @brief Enumeración para la MEF de configuración del ESP
+ * 
+ */
+typedef enum{
+			CWMODE_DEF,
+			CWDHCP_DEF,
+			CWLAP,
+			CWJAP_DEF,
+            CIPMUX,
+			CIFSR,
+			CIPSTART,
+			CIPMODE,
+			CIPSEND,
+			AWAITINGRESPONSE,
+			INCOMMINGRESPONSE,
+            READYTOTRASMIT,
+			AUTOMATIC
+} _eEstadoESP;
+
+/**
+ * @brief Enumeración de la MEF de las tareas comunes de la clase Wifi
+ * 
+ */
+typedef enum{
+        RESETWIFI,
+        STARTUP,
+        STANBY,
+        CONFIG,
+        READY,
+        ATEXIT,         //!< Se envió "+++" y se espera que el ESP salga del modo transparente
+        ATCOMMAND,      //!< Ejecutando los comandos AT encolados
+        ATRESUME        //!< Se envió AT+CIPSEND y se espera el '>' para volver al modo transparente
+}_eStateTask;
+
+/**
+ * @brief Resultado de un comando AT encolado
+ * 
+ */
+typedef enum{
+        ATCMDOK,
+        ATCMDERROR,
+        ATCMDTIMEOUT
+}_eAtStatus;
+
+/**
+ * @brief Función que se llama al terminar un comando AT encolado
+ * Recibe el resultado (_eAtStatus), la respuesta del ESP sin la línea final y su longitud
+ */
+typedef Callback<void(uint8_t, const uint8_t *, uint8_t)> atCallback;
+
+/**
+ * @brief Función que recibe cada byte de la respuesta de un comando AT mientras llega
+ * Sirve para procesar respuestas largas que no entran en el buffer de respuesta
+ */
+typedef Callback<void(uint8_t)> atDataCallback;
+
+#define ATQUEUELENGTH       4       //!< Comandos AT que se pueden encolar
+#define ATRESPONSELENGTH    64      //!< Bytes de respuesta que se guardan por comando
+#define ATLINELENGTH        8       //!< Bytes que se guardan de cada línea para detectar OK/ERROR
+
+/**
+ * @brief Comando AT encolado
+ * 
+ */
+typedef struct{
+    const char *command;    //!< Cadena del comando terminada en "\r\n", debe seguir existiendo hasta que termine
+    uint16_t timeOut;       //!< Tiempo máximo de espera de la respuesta en ms
+    atCallback done;        //!< Función a llamar al terminar
+    atDataCallback onData;  //!< Función a llamar con cada byte recibido (opcional)
+}_sAtCommand;
+
 /*==================[ Class Definitions ]============================================*/
 class Wifi
 {
@@ -35,11 +122,14 @@ class Wifi
         /**
          * @brief Construct a new Wifi object
          * 
+         * @param serial        Puerto serie al que está conectado el ESP8266
+         * @param chipEnable    Salida conectada al CH_PD del ESP8266
          * @param buff          Puntero al buffer circular de recepción 
          * @param indexWRx      Puntero al indice de escritura del buffer circular de recepción
+         * @param indexRRx      Puntero al indice de lectura del buffer circular de recepción, para no pisar datos sin leer
          * @param lengthBuff    Tamaño del buffer 
          */
-         Wifi(uint8_t *buff, uint8_t *indexWRx, uint32_t lengthBuff);
+         Wifi(RawSerial &serial, DigitalOut &chipEnable, uint8_t *buff, uint8_t *indexWRx, const uint8_t *indexRRx, uint32_t lengthBuff);
         /**
          * @brief Destroy the Wifi object
          * 
@@ -53,11 +143,33 @@ class Wifi
         void configWifi(wifiData *);
         /**
          * @brief  Escribe los datos para enviar por wifi en el buffer de transmisión
+         * Nunca pisa datos que no se transmitieron, escribe solo lo que entra en el espacio libre.
+         * Si el Wifi no está listo no acepta nada.
          * 
          * @param buff      Puntero al buffer que contiene los datos para ser enviados por wifi
          * @param nBytes    Cantidad de datos que se quieren enviar
+         * @return uint8_t  Cantidad de datos que se aceptaron
          */
-        void writeWifiData(uint8_t *buff, uint8_t nBytes);
+        uint8_t writeWifiData(uint8_t *buff, uint8_t nBytes);
+        /**
+         * @brief Consulta si el buffer de transmisión superó la marca alta y todavía no bajó de la marca baja
+         * 
+         * @return true     Hay que dejar de generar datos
+         * @return false    Se puede seguir escribiendo
+         */
+        uint8_t isTxCongested();
+        /**
+         * @brief Bytes que esperan en el buffer de transmisión del ESP
+         * 
+         * @return uint8_t Bytes sin transmitir
+         */
+        uint8_t txPending();
+        /**
+         * @brief Registra la función que se llama al cruzar las marcas alta (true) y baja (false) del buffer de transmisión
+         * 
+         * @param watermark Función a llamar
+         */
+        void attachTxWatermark(Callback<void(bool)> watermark);
         /**
          * @brief Tareas períodicas que ejecuta la clase
          * 
@@ -77,15 +189,72 @@ class Wifi
         void initTask();
         /**
          * @brief Resetea el Wifi para comenzar nuevamente a cargar los datos de conexion
+         * Descarta los comandos AT encolados y lo que quedaba por transmitir, el Wifi deja de estar listo
          * 
          */
         void resetWifi();
+        /**
+         * @brief Encola un comando AT para ejecutarlo sin perder la conexión
+         * Cuando el Wifi está listo sale del modo transparente con "+++", ejecuta los comandos encolados y
+         * vuelve con AT+CIPSEND. Mientras tanto los datos a transmitir se siguen guardando en el buffer.
+         * 
+         * @param command   Cadena del comando terminada en "\r\n"
+         * @param timeOut   Tiempo máximo de espera de la respuesta en ms
+         * @param done      Función a llamar al terminar el comando
+         * @param onData    Función a llamar con cada byte de la respuesta (opcional)
+         * @return true     El comando quedó encolado
+         * @return false    La cola está llena
+         */
+        bool sendATCommand(const char *command, uint16_t timeOut, atCallback done, atDataCallback onData=atDataCallback());
+        /**
+         * @brief Habilita el control de flujo con el ESP
+         * RTS se maneja por software según lo ocupado del buffer de recepción activo: se pone en 1 (el ESP deja de
+         * transmitir) al superar RXHIGHWATER y vuelve a 0 al bajar de RXLOWWATER. CTS lo atiende la USART, que deja
+         * de transmitir mientras el ESP lo mantenga en 1. El ESP tiene que tener habilitado el control de flujo (AT+UART_DEF).
+         * 
+         * @param rts   Salida conectada al CTS del ESP, NULL para no usarla
+         * @param cts   Pin conectado al RTS del ESP, NC para no usarlo
+         */
+        void enableFlowControl(DigitalOut *rts, PinName cts);
+        /**
+         * @brief Bytes recibidos que se descartaron porque el buffer de recepción estaba lleno
+         * 
+         * @return uint16_t Cantidad de bytes descartados (satura en 0xFFFF)
+         */
+        uint16_t getRxOverruns();
+        /**
+         * @brief Registra la función que recibe cada byte que pasa por el puerto del ESP, para capturar el tráfico
+         * Se llama desde la IRQ de recepción, tiene que ser corta.
+         * 
+         * @param capture   Función a llamar con (true si se transmitió, byte)
+         */
+        void attachCapture(Callback<void(bool, uint8_t)> capture);
     private:
         /**
          * @brief Envía los datos a travéz del ESP
          * 
          */
         void wifiSend();
+        /**
+         * @brief Espacio libre en el buffer de transmisión
+         * 
+         * @return uint8_t Bytes libres
+         */
+        uint8_t txFree();
+        /**
+         * @brief Actualiza el estado de congestión y avisa si cruzó alguna marca
+         * 
+         */
+        void checkTxWatermark();
+        /**
+         * @brief Escribe un comando de wifiData hasta el '\n' solo si entra completo
+         * 
+         * @param command   Comando
+         * @param maxLength Tamaño del campo de wifiData
+         * @return true     Se escribió el comando
+         * @return false    No había lugar
+         */
+        bool wifiWriteCommand(const uint8_t *command, uint8_t maxLength);
         /**
          * @brief   MEF para configurar el Wifi
          * 
@@ -101,7 +270,115 @@ class Wifi
          * @return false 
          */
         bool wifiResponse(const char *, unsigned char );
+        /**
+         * @brief Función que se  llama cuando ocurre la IRQ_Rx
+         * 
+         */
+        void onDataRx();
+        /**
+         * @brief Bytes ocupados en el buffer de recepción que se está llenando
+         * 
+         * @return uint16_t Bytes sin leer
+         */
+        uint16_t rxUsed();
+        /**
+         * @brief Actualiza RTS según las marcas del buffer de recepción, se llama desde la IRQ y desde taskWifi
+         * 
+         */
+        void updateRts();
+        /**
+         * @brief Envía de a un byte la cadena AT en curso
+         * 
+         * @return true     Terminó de enviar la cadena
+         * @return false    Quedan bytes por enviar
+         */
+        bool atSend();
+        /**
+         * @brief Procesa lo recibido durante un comando AT en curso
+         * 
+         * @return int8_t   -1 si la respuesta no terminó, o el _eAtStatus del comando
+         */
+        int8_t atReceive();
+        /**
+         * @brief Termina el comando AT en curso, llama a su callback y pasa al siguiente
+         * 
+         * @param status    Resultado del comando
+         */
+        void atFinish(uint8_t status);
+        /**
+         * @brief Arranca el comando AT que está al frente de la cola
+         * 
+         */
+        void atStart();
+        /**
+         * @brief Escribe una cadena en el buffer de transmisión del ESP
+         * 
+         * @param cadena Cadena terminada en '\0'
+         * @return true     Se escribió la cadena completa
+         * @return false    No había lugar, no se escribió nada
+         */
+        bool wifiWriteString(const char *cadena);
+        /**
+         * @brief Prepara la tabla de APs para buscar el SSID configurado en cwjap
+         * 
+         */
+        void startScan();
+        /**
+         * @brief Recibe el resultado de AT+CWJAP? y decide si hay que buscar un AP mejor
+         * 
+         */
+        void onRoamStatus(uint8_t status, const uint8_t *response, uint8_t length);
+        /**
+         * @brief Recibe cada byte de AT+CWLAP durante el roaming
+         * 
+         */
+        void onRoamData(uint8_t dato);
+        /**
+         * @brief Recibe el final de AT+CWLAP y se cambia de AP si hay uno suficientemente mejor
+         * 
+         */
+        void onRoamScan(uint8_t status, const uint8_t *response, uint8_t length);
 
-   
+        RawSerial &wifiCom;                 //!< Puerto serie del ESP
+        DigitalOut &chipEnableESP;          //!< CH_PD del ESP
+        uint8_t *buffRx;                    //!< Puntero al bufer circular de recepción
+        uint8_t *indexRxWrite;              //!< Puntero al indice de escritura del bufer circular de recepción
+        const uint8_t *indexRxRead;         //!< Puntero al indice de lectura del bufer circular de recepción
+        uint32_t maxBufferLength;           //!< Tamaño del bufer circular de recepción
+        wifiData *dataConfigwifi;           //!< Puntero a los datos de configuración
+        bool configActive;                  //!< Flag de configuración activa
+        bool startUpActive;                 //!< Flag de inicio de chequeo del ESP
+        uint8_t numTimeSend, numTimeRecive;
+        uint8_t wifiReady;
+        uint16_t delayRespuesta;            //!< Tiempo de espera de la respuesta del comando en curso
+        _sDatoConfig esp8266Data;
+        _eEstadoESP espState;
+        _eStateTask wifiTaskState;
+        Timer timerWifi;
+        uint32_t timeWifi;
+        uint32_t timestartUp;
+        uint32_t timerReset;
+        uint32_t timeLastTx;                //!< Último envío de datos en modo transparente
+        bool atActive;                      //!< Flag de comandos AT en curso
+        const char *atPtr;                  //!< Próximo byte a enviar de la cadena AT en curso
+        _sAtCommand atQueue[ATQUEUELENGTH]; //!< Cola de comandos AT
+        uint8_t atHead, atCount;
+        uint8_t atResponse[ATRESPONSELENGTH];
+        uint8_t atLength;
+        uint8_t atLine[ATLINELENGTH];
+        uint8_t atLineLength;
+        _sApScan apScan;                    //!< APs del SSID configurado encontrados en el último AT+CWLAP
+        _sApInfo apActual;                  //!< AP al que está conectado según el último AT+CWJAP?
+        uint32_t timeScan;                  //!< Inicio del AT+CWLAP durante la configuración
+        uint32_t timeRoam;                  //!< Última evaluación del roaming
+        bool roamBusy;                      //!< Hay una evaluación de roaming en curso
+        char roamJoin[128];                 //!< AT+CWJAP_CUR con el BSSID elegido
+        char roamStart[60];                 //!< AT+CIPSTART para reabrir la conexión luego de cambiar de AP
+        bool txCongested;                   //!< El buffer de transmisión superó la marca alta
+        Callback<void(bool)> txWatermark;   //!< Aviso de cruce de las marcas del buffer de transmisión
+        uint16_t rxOverruns;                //!< Bytes descartados por buffer de recepción lleno
+        DigitalOut *rtsESP;                 //!< Salida RTS, NULL sin control de flujo
+        bool rxStopped;                     //!< RTS está pidiendo al ESP que deje de transmitir
+        Callback<void(bool, uint8_t)> captureHook;  //!< Recibe cada byte transmitido y recibido
 };
 #endif
\ No newline at end of file